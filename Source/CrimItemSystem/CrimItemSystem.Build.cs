@@ -27,6 +27,7 @@ public class CrimItemSystem : ModuleRules
 				"CoreUObject",
 				"Engine", 
 				"AIModule",
+				"AssetRegistry",
 			}
 			);
 		
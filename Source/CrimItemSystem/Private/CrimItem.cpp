@@ -4,7 +4,23 @@
 #include "CrimItem.h"
 
 #include "CrimItemDefinition.h"
+#include "CrimItemDefinitionRegistry.h"
+#include "ItemContainer/CrimItemContainerBase.h"
+#include "Algo/BinarySearch.h"
 
+namespace CrimItem
+{
+	/** Finalizer from SplitMix64, spreads the bits of a combined value. */
+	static uint64 MixSignature(uint64 Value)
+	{
+		Value ^= Value >> 30;
+		Value *= 0xbf58476d1ce4e5b9ull;
+		Value ^= Value >> 27;
+		Value *= 0x94d049bb133111ebull;
+		Value ^= Value >> 31;
+		return Value;
+	}
+}
 
 FCrimItem::FCrimItem()
 {
@@ -19,7 +35,7 @@ bool FCrimItem::IsMatching(const TInstancedStruct<FCrimItem>& TestItem) const
 		return false;
 	}
 	
-	if (TestItem.GetPtr<FCrimItem>()->ItemDefinition != ItemDefinition)
+	if (TestItem.GetPtr<FCrimItem>()->GetItemDefinitionHandle() != GetItemDefinitionHandle())
 	{
 		return false;
 	}
@@ -37,8 +53,48 @@ bool FCrimItem::IsMatching(const TInstancedStruct<FCrimItem>& TestItem) const
 	return true;
 }
 
+uint64 FCrimItem::GetStackSignature() const
+{
+	uint64 Signature = CrimItem::MixSignature(uint32(GetItemDefinitionHandle().GetIndex()));
+
+	// TagStats and Fragments are combined with an addition so the order they are stored in does not matter.
+	uint64 TagStatsSignature = 0;
+	for (const FCrimItemTagStack& Stack : TagStats.GetTagStats())
+	{
+		TagStatsSignature += CrimItem::MixSignature((uint64(GetTypeHash(Stack.GetTag())) << 32) | uint32(Stack.GetCount()));
+	}
+
+	uint64 FragmentsSignature = 0;
+	for (int32 i = 0; i < Fragments.Num(); i++)
+	{
+		const UScriptStruct* Struct = Fragments[i].GetScriptStruct();
+		if (Struct == nullptr || GetFragmentByScriptStruct(Struct) != Fragments[i].GetPtr<FCrimItemFragment>())
+		{
+			// Only the first fragment of a type takes part in IsMatching.
+			continue;
+		}
+		FragmentsSignature += CrimItem::MixSignature(GetTypeHash(Struct) ^ Fragments[i].Get<FCrimItemFragment>().GetMatchingHash());
+	}
+
+	return CrimItem::MixSignature(Signature ^ CrimItem::MixSignature(TagStatsSignature)) ^ CrimItem::MixSignature(FragmentsSignature + 1);
+}
+
+FCrimItemDefinitionHandle FCrimItem::GetItemDefinitionHandle() const
+{
+	if (!ItemDefinitionHandle.IsValid())
+	{
+		ItemDefinitionHandle = UCrimItemDefinitionRegistry::FindOrAddHandle(ItemDefinition.ToSoftObjectPath());
+	}
+	return ItemDefinitionHandle;
+}
+
 UCrimItemManagerComponent* FCrimItem::GetItemManager() const
 {
+	if (!ItemManager.IsValid() && ItemContainer.IsValid())
+	{
+		// On clients the item can be received before its ItemContainer's ItemManager.
+		return ItemContainer->GetItemManagerComponent();
+	}
 	return ItemManager.Get();
 }
 
@@ -47,66 +103,360 @@ UCrimItemContainerBase* FCrimItem::GetItemContainer() const
 	return ItemContainer.Get();
 }
 
-bool FCrimItem::AreFragmentsEqual(const TInstancedStruct<FCrimItem>& TestItem) const
+const TInstancedStruct<FCrimItemFragment>* FCrimItem::FindFragment(const UScriptStruct* FragmentType) const
 {
-	const FCrimItem* TestItemPtr = TestItem.GetPtr<FCrimItem>();
-	
-	// Compare this Item's extensions to the TestItem's extensions.
+	const int32 Index = FindFragmentIndex(FragmentType, false);
+	return Index != INDEX_NONE ? &Fragments[Index] : nullptr;
+}
+
+void FCrimItem::SetFragment(int32 Index, const TInstancedStruct<FCrimItemFragment>& Fragment)
+{
+	Fragments[Index] = Fragment;
+	FragmentLookup.Reset();
+}
+
+void FCrimItem::AddFragment(const TInstancedStruct<FCrimItemFragment>& Fragment)
+{
+	Fragments.Add(Fragment);
+	FragmentLookup.Reset();
+}
+
+void FCrimItem::RefreshCachedState()
+{
+	TagStats.RefreshCachedState();
+	BuildFragmentLookup();
+	// The ItemDefinition may have been replaced by replication or loading.
+	ItemDefinitionHandle = UCrimItemDefinitionRegistry::FindOrAddHandle(ItemDefinition.ToSoftObjectPath());
+}
+
+SIZE_T FCrimItem::GetAllocatedSize() const
+{
+	SIZE_T Result = TagStats.GetAllocatedSize() + Fragments.GetAllocatedSize();
+	if (FragmentLookup.IsValid())
+	{
+		// Shared with the copies of this item, so this counts it once per copy.
+		Result += sizeof(FCrimItemFragmentLookupTable) + FragmentLookup->Entries.GetAllocatedSize();
+	}
 	for (const TInstancedStruct<FCrimItemFragment>& Fragment : Fragments)
 	{
-		if (Fragment.IsValid())
+		if (const UScriptStruct* FragmentStruct = Fragment.GetScriptStruct())
+		{
+			Result += FragmentStruct->GetStructureSize();
+		}
+	}
+	return Result;
+}
+
+bool FCrimItem::NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess)
+{
+	bOutSuccess = true;
+	Ar << ItemGuid;
+
+	// A net reference only sends the full path the first time the ItemDefinition is replicated on a connection.
+	UObject* Definition = ItemDefinition.Get();
+	uint8 bHasDefinition = !ItemDefinition.IsNull();
+	uint8 bDefinitionAsReference = bHasDefinition && Definition && Map;
+	Ar.SerializeBits(&bHasDefinition, 1);
+	if (!bHasDefinition)
+	{
+		bDefinitionAsReference = false;
+	}
+	else
+	{
+		Ar.SerializeBits(&bDefinitionAsReference, 1);
+		if (bDefinitionAsReference)
 		{
-			if (const FCrimItemFragment* FragmentPtr = TestItemPtr->GetFragmentByScriptStruct(Fragment.GetScriptStruct()))
+			if (!Map)
 			{
-				if (!FragmentPtr->IsMatching(Fragment))
-				{
-					return false;
-				}
+				Ar.SetError();
+				bOutSuccess = false;
+				return false;
 			}
-			else
+			Map->SerializeObject(Ar, UCrimItemDefinition::StaticClass(), Definition);
+		}
+		else
+		{
+			FSoftObjectPath Path = ItemDefinition.ToSoftObjectPath();
+			Path.NetSerialize(Ar, Map, bOutSuccess);
+			if (Ar.IsLoading())
 			{
-				return false;
+				ItemDefinition = Path;
 			}
 		}
 	}
+	if (Ar.IsLoading())
+	{
+		if (bDefinitionAsReference)
+		{
+			// Null while the reference is unmapped. The FastArraySerializer serializes the item again once it is.
+			ItemDefinition = Cast<UCrimItemDefinition>(Definition);
+		}
+		else if (!bHasDefinition)
+		{
+			ItemDefinition.Reset();
+		}
+		ItemDefinitionHandle = FCrimItemDefinitionHandle();
+	}
+
+	CrimItem::NetSerializePackedInt(Ar, Quantity);
+
+	bool bTagStatsSuccess = true;
+	TagStats.NetSerialize(Ar, Map, bTagStatsSuccess);
+	bOutSuccess &= bTagStatsSuccess;
+
+	// Fragments that still hold the default values of the ItemDefinition are rebuilt from it on the receiving side, for
+	// the fragment types whose defaults are the same on every machine.
+	const UCrimItemDefinition* ItemDef = bDefinitionAsReference ? Cast<UCrimItemDefinition>(Definition) : nullptr;
+	const FCrimItem* DefaultItem = ItemDef ? ItemDef->GetDefaultItem().GetPtr<FCrimItem>() : nullptr;
+
+	uint32 NumFragments = Fragments.Num();
+	Ar.SerializeIntPacked(NumFragments);
+	if (Ar.IsLoading())
+	{
+		if (NumFragments > CrimItem::MaxNetFragments)
+		{
+			Ar.SetError();
+			bOutSuccess = false;
+			return false;
+		}
+		Fragments.SetNum(NumFragments);
+	}
 
-	// Compare all the TestItem's extensions with this Item's extensions.
-	for (const TInstancedStruct<FCrimItemFragment>& Ext : TestItemPtr->Fragments)
+	for (int32 i = 0; i < Fragments.Num(); i++)
 	{
-		if (Ext.IsValid())
+		const TInstancedStruct<FCrimItemFragment>* DefaultFragment = DefaultItem && DefaultItem->Fragments.IsValidIndex(i) ?
+			&DefaultItem->Fragments[i] : nullptr;
+
+		uint8 bIsDefault = Ar.IsSaving() && bDefinitionAsReference && DefaultFragment && Fragments[i].IsValid() &&
+			Fragments[i].Get<FCrimItemFragment>().CanReplicateAsDefault() && *DefaultFragment == Fragments[i];
+		Ar.SerializeBits(&bIsDefault, 1);
+		if (bIsDefault)
 		{
-			if (const FCrimItemFragment* FragmentPtr = GetFragmentByScriptStruct(Ext.GetScriptStruct()))
+			if (Ar.IsLoading() && DefaultFragment)
 			{
-				if (!FragmentPtr->IsMatching(Ext))
-				{
-					return false;
-				}
+				Fragments[i] = *DefaultFragment;
 			}
-			else
+			// Without the ItemDefinition the reference is unmapped, and ItemDefinition is null. A new item keeps an
+			// empty fragment and an existing one keeps its previous value. FastArrayDeltaSerialize records the unmapped
+			// NetGUIDs of each item it reads along with the item's bits, reads the item again once the ItemDefinition
+			// is mapped and calls PostReplicatedChange, which restores the fragment.
+		}
+		else
+		{
+			bool bFragmentSuccess = true;
+			Fragments[i].NetSerialize(Ar, Map, bFragmentSuccess);
+			bOutSuccess &= bFragmentSuccess;
+		}
+	}
+	if (Ar.IsLoading())
+	{
+		FragmentLookup.Reset();
+	}
+
+	return true;
+}
+
+bool FCrimItem::NetSerializeSections(FArchive& Ar, UPackageMap* Map, ECrimItemNetSection Sections, bool& bOutSuccess)
+{
+	bOutSuccess = true;
+
+	uint32 SectionBits = uint32(Sections);
+	Ar.SerializeIntPacked(SectionBits);
+	Sections = ECrimItemNetSection(SectionBits);
+
+	// Sent so a receiver that somehow has a different fragment layout fails instead of applying to the wrong fragment.
+	uint32 NumFragments = Fragments.Num();
+	Ar.SerializeIntPacked(NumFragments);
+	if (Ar.IsLoading() && NumFragments != uint32(Fragments.Num()))
+	{
+		Ar.SetError();
+		bOutSuccess = false;
+		return false;
+	}
+
+	if (EnumHasAnyFlags(Sections, ECrimItemNetSection::Quantity))
+	{
+		CrimItem::NetSerializePackedInt(Ar, Quantity);
+	}
+	if (EnumHasAnyFlags(Sections, ECrimItemNetSection::TagStats))
+	{
+		bool bTagStatsSuccess = true;
+		TagStats.NetSerialize(Ar, Map, bTagStatsSuccess);
+		bOutSuccess &= bTagStatsSuccess;
+	}
+	for (int32 i = 0; i < Fragments.Num(); i++)
+	{
+		if (EnumHasAnyFlags(Sections, CrimItem::GetFragmentNetSection(i)))
+		{
+			bool bFragmentSuccess = true;
+			Fragments[i].NetSerialize(Ar, Map, bFragmentSuccess);
+			bOutSuccess &= bFragmentSuccess;
+		}
+	}
+	if (Ar.IsLoading())
+	{
+		FragmentLookup.Reset();
+	}
+
+	return true;
+}
+
+bool FCrimItem::AreFragmentsEqual(const TInstancedStruct<FCrimItem>& TestItem) const
+{
+	const FCrimItem* TestItemPtr = TestItem.GetPtr<FCrimItem>();
+
+	// Both lookup tables are sorted by struct, so the fragment types can be compared in a single pass. Entries
+	// without an ExactIndex only exist for parent structs and are skipped.
+	const TArray<FCrimItemFragmentLookup>& Lookup = GetFragmentLookup().Entries;
+	const TArray<FCrimItemFragmentLookup>& TestLookup = TestItemPtr->GetFragmentLookup().Entries;
+	int32 NumFragmentTypes = 0;
+	int32 i = 0;
+	int32 j = 0;
+	while (true)
+	{
+		while (i < Lookup.Num() && Lookup[i].ExactIndex == INDEX_NONE)
+		{
+			i++;
+		}
+		while (j < TestLookup.Num() && TestLookup[j].ExactIndex == INDEX_NONE)
+		{
+			j++;
+		}
+		if (i == Lookup.Num() || j == TestLookup.Num())
+		{
+			if (i != Lookup.Num() || j != TestLookup.Num())
 			{
+				// One of the items has a fragment type the other does not.
 				return false;
 			}
+			break;
+		}
+		if (Lookup[i].Struct != TestLookup[j].Struct)
+		{
+			return false;
 		}
+
+		const TInstancedStruct<FCrimItemFragment>& Fragment = Fragments[Lookup[i].ExactIndex];
+		const TInstancedStruct<FCrimItemFragment>& TestFragment = TestItemPtr->Fragments[TestLookup[j].ExactIndex];
+		if (!TestFragment.Get<FCrimItemFragment>().IsMatching(Fragment) ||
+			!Fragment.Get<FCrimItemFragment>().IsMatching(TestFragment))
+		{
+			return false;
+		}
+		NumFragmentTypes++;
+		i++;
+		j++;
 	}
 
-	return true;
+	// Duplicate fragments of a type are compared against the first fragment of that type in the other item.
+	auto AreDuplicatesMatching = [NumFragmentTypes](const FCrimItem& ThisItem, const FCrimItem& OtherItem)
+	{
+		int32 NumValidFragments = 0;
+		for (const TInstancedStruct<FCrimItemFragment>& Fragment : ThisItem.Fragments)
+		{
+			NumValidFragments += Fragment.IsValid() ? 1 : 0;
+		}
+		if (NumValidFragments == NumFragmentTypes)
+		{
+			return true;
+		}
+
+		for (int32 Index = 0; Index < ThisItem.Fragments.Num(); Index++)
+		{
+			const TInstancedStruct<FCrimItemFragment>& Fragment = ThisItem.Fragments[Index];
+			if (Fragment.IsValid() && ThisItem.FindFragmentIndex(Fragment.GetScriptStruct(), true) != Index)
+			{
+				const FCrimItemFragment* OtherFragment = OtherItem.GetFragmentByScriptStruct(Fragment.GetScriptStruct());
+				if (!OtherFragment || !OtherFragment->IsMatching(Fragment))
+				{
+					return false;
+				}
+			}
+		}
+		return true;
+	};
+
+	return AreDuplicatesMatching(*this, *TestItemPtr) && AreDuplicatesMatching(*TestItemPtr, *this);
 }
 
 const FCrimItemFragment* FCrimItem::GetFragmentByScriptStruct(const UScriptStruct* Struct) const
 {
-	for (const TInstancedStruct<FCrimItemFragment>& Fragment : Fragments)
+	const int32 Index = FindFragmentIndex(Struct, true);
+	return Index != INDEX_NONE ? Fragments[Index].GetPtr<FCrimItemFragment>() : nullptr;
+}
+
+int32 FCrimItem::FindFragmentIndex(const UScriptStruct* Struct, bool bExactMatch) const
+{
+	if (Struct == nullptr)
 	{
-		if (Fragment.GetScriptStruct() == Struct)
+		return INDEX_NONE;
+	}
+
+	const TArray<FCrimItemFragmentLookup>& Lookup = GetFragmentLookup().Entries;
+	const int32 LookupIndex = Algo::BinarySearchBy(Lookup, Struct, &FCrimItemFragmentLookup::Struct);
+	if (LookupIndex == INDEX_NONE)
+	{
+		return INDEX_NONE;
+	}
+
+	const int32 Index = bExactMatch ? Lookup[LookupIndex].ExactIndex : Lookup[LookupIndex].FirstIndex;
+	checkSlow(Index == INDEX_NONE || Fragments[Index].GetScriptStruct() == Struct ||
+		(!bExactMatch && Fragments[Index].GetScriptStruct()->IsChildOf(Struct)));
+	return Index;
+}
+
+void FCrimItem::BuildFragmentLookup() const
+{
+	TSharedRef<FCrimItemFragmentLookupTable> NewLookup = MakeShared<FCrimItemFragmentLookupTable>();
+	NewLookup->NumFragments = Fragments.Num();
+	TArray<FCrimItemFragmentLookup>& Entries = NewLookup->Entries;
+	for (int32 Index = 0; Index < Fragments.Num(); Index++)
+	{
+		const UScriptStruct* FragmentStruct = Fragments[Index].GetScriptStruct();
+		for (const UScriptStruct* Struct = FragmentStruct; Struct; Struct = Cast<UScriptStruct>(Struct->GetSuperStruct()))
 		{
-			return Fragment.GetPtr<FCrimItemFragment>();
+			const int32 LookupIndex = Algo::LowerBoundBy(Entries, Struct, &FCrimItemFragmentLookup::Struct);
+			if (!Entries.IsValidIndex(LookupIndex) || Entries[LookupIndex].Struct != Struct)
+			{
+				FCrimItemFragmentLookup NewEntry;
+				NewEntry.Struct = Struct;
+				Entries.Insert(NewEntry, LookupIndex);
+			}
+
+			FCrimItemFragmentLookup& Entry = Entries[LookupIndex];
+			if (Entry.FirstIndex == INDEX_NONE)
+			{
+				Entry.FirstIndex = Index;
+			}
+			if (Struct == FragmentStruct && Entry.ExactIndex == INDEX_NONE)
+			{
+				Entry.ExactIndex = Index;
+			}
+
+			if (Struct == FCrimItemFragment::StaticStruct())
+			{
+				break;
+			}
 		}
 	}
-	return nullptr;
+	Entries.Shrink();
+	FragmentLookup = NewLookup;
+}
+
+const FCrimItemFragmentLookupTable& FCrimItem::GetFragmentLookup() const
+{
+	// Only the number of fragments is checked, replacing a fragment clears the table. See SetFragment.
+	if (!FragmentLookup.IsValid() || FragmentLookup->NumFragments != Fragments.Num())
+	{
+		BuildFragmentLookup();
+	}
+	return *FragmentLookup;
 }
 
 void FCrimItem::Initialize(const UCrimItemDefinition* ItemDef)
 {
 	ItemDefinition = ItemDef->GetPathName();
+	ItemDefinitionHandle = ItemDef->GetItemDefinitionHandle();
 
 	for (const TTuple<FGameplayTag, int>& Pair : ItemDef->DefaultStats)
 	{
@@ -3,6 +3,8 @@
 
 #include "CrimItemDefinition.h"
 
+#include "CrimItemDefinitionRegistry.h"
+#include "ItemContainer/CrimItemContainerBase.h"
 #include "UI/ViewModel/CrimItemViewModel.h"
 #include "UObject/AssetRegistryTagsContext.h"
 
@@ -35,3 +37,83 @@ void UCrimItemDefinition::GetAssetRegistryTags(FAssetRegistryTagsContext Context
 		}
 	}
 }
+
+void UCrimItemDefinition::PostLoad()
+{
+	Super::PostLoad();
+
+	BuildFragmentMap();
+}
+
+#if WITH_EDITOR
+void UCrimItemDefinition::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
+{
+	Super::PostEditChangeProperty(PropertyChangedEvent);
+
+	// The type of a fragment can change without changing the number of fragments.
+	FragmentMapNum = INDEX_NONE;
+	bDefaultItemBuilt = false;
+}
+#endif
+
+const TInstancedStruct<FCrimItemDefinitionFragment>* UCrimItemDefinition::FindFragment(const UScriptStruct* FragmentType) const
+{
+	if (FragmentType == nullptr)
+	{
+		return nullptr;
+	}
+
+	if (FragmentMapNum != Fragments.Num())
+	{
+		BuildFragmentMap();
+	}
+
+	const int32* Index = FragmentMap.Find(FragmentType);
+	if (Index == nullptr)
+	{
+		return nullptr;
+	}
+
+	const UScriptStruct* FragmentStruct = Fragments[*Index].GetScriptStruct();
+	if (FragmentStruct && FragmentStruct->IsChildOf(FragmentType))
+	{
+		return &Fragments[*Index];
+	}
+
+	// The fragment was replaced after the map was built.
+	BuildFragmentMap();
+	return FindFragment(FragmentType);
+}
+
+FCrimItemDefinitionHandle UCrimItemDefinition::GetItemDefinitionHandle() const
+{
+	return UCrimItemDefinitionRegistry::FindOrAddHandle(FSoftObjectPath(this));
+}
+
+const TInstancedStruct<FCrimItem>& UCrimItemDefinition::GetDefaultItem() const
+{
+	if (!bDefaultItemBuilt)
+	{
+		DefaultItem = UCrimItemContainerBase::CreateItem(this);
+		bDefaultItemBuilt = true;
+	}
+	return DefaultItem;
+}
+
+void UCrimItemDefinition::BuildFragmentMap() const
+{
+	FragmentMap.Reset();
+	for (int32 i = 0; i < Fragments.Num(); i++)
+	{
+		for (const UScriptStruct* Struct = Fragments[i].GetScriptStruct(); Struct; Struct = Cast<UScriptStruct>(Struct->GetSuperStruct()))
+		{
+			// Only the first fragment of a type is returned by lookups.
+			FragmentMap.FindOrAdd(Struct, i);
+			if (Struct == FCrimItemDefinitionFragment::StaticStruct())
+			{
+				break;
+			}
+		}
+	}
+	FragmentMapNum = Fragments.Num();
+}
@@ -0,0 +1,133 @@
+﻿// Copyright Soccertitan
+
+
+#include "CrimItemDefinitionRegistry.h"
+
+#include "CrimItemDefinition.h"
+#include "AssetRegistry/IAssetRegistry.h"
+
+namespace CrimItemDefinitionRegistry
+{
+	/** Guards the maps below. Handles are never removed, so a registered handle stays valid until shutdown. */
+	FRWLock Lock;
+	/** Maps an ItemDefinition to its handle index. */
+	TMap<FSoftObjectPath, int32> HandleByDefinition;
+	/** The ItemDefinition of each handle, by handle index. */
+	TArray<FSoftObjectPath> DefinitionByHandle;
+}
+
+void UCrimItemDefinitionRegistry::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	IAssetRegistry* AssetRegistry = IAssetRegistry::Get();
+	if (AssetRegistry && AssetRegistry->IsLoadingAssets())
+	{
+		// In the editor the AssetRegistry scans asynchronously. Definitions requested before it is done are registered
+		// lazily, the remaining ones once the scan completes.
+		OnFilesLoadedHandle = AssetRegistry->OnFilesLoaded().AddStatic(&UCrimItemDefinitionRegistry::RegisterAllItemDefinitions);
+	}
+	else
+	{
+		RegisterAllItemDefinitions();
+	}
+}
+
+void UCrimItemDefinitionRegistry::Deinitialize()
+{
+	if (OnFilesLoadedHandle.IsValid())
+	{
+		if (IAssetRegistry* AssetRegistry = IAssetRegistry::Get())
+		{
+			AssetRegistry->OnFilesLoaded().Remove(OnFilesLoadedHandle);
+		}
+		OnFilesLoadedHandle.Reset();
+	}
+
+	Super::Deinitialize();
+}
+
+FCrimItemDefinitionHandle UCrimItemDefinitionRegistry::FindOrAddHandle(const FSoftObjectPath& ItemDefinition)
+{
+	if (ItemDefinition.IsNull())
+	{
+		return FCrimItemDefinitionHandle();
+	}
+
+	{
+		FReadScopeLock ReadLock(CrimItemDefinitionRegistry::Lock);
+		if (const int32* Index = CrimItemDefinitionRegistry::HandleByDefinition.Find(ItemDefinition))
+		{
+			return FCrimItemDefinitionHandle(*Index);
+		}
+	}
+
+	FWriteScopeLock WriteLock(CrimItemDefinitionRegistry::Lock);
+	// Another thread may have registered it between the locks.
+	if (const int32* Index = CrimItemDefinitionRegistry::HandleByDefinition.Find(ItemDefinition))
+	{
+		return FCrimItemDefinitionHandle(*Index);
+	}
+	const int32 Index = CrimItemDefinitionRegistry::DefinitionByHandle.Add(ItemDefinition);
+	CrimItemDefinitionRegistry::HandleByDefinition.Add(ItemDefinition, Index);
+	return FCrimItemDefinitionHandle(Index);
+}
+
+FCrimItemDefinitionHandle UCrimItemDefinitionRegistry::FindHandle(const FSoftObjectPath& ItemDefinition)
+{
+	FReadScopeLock ReadLock(CrimItemDefinitionRegistry::Lock);
+	const int32* Index = CrimItemDefinitionRegistry::HandleByDefinition.Find(ItemDefinition);
+	return Index ? FCrimItemDefinitionHandle(*Index) : FCrimItemDefinitionHandle();
+}
+
+FSoftObjectPath UCrimItemDefinitionRegistry::GetItemDefinition(FCrimItemDefinitionHandle Handle)
+{
+	FReadScopeLock ReadLock(CrimItemDefinitionRegistry::Lock);
+	if (CrimItemDefinitionRegistry::DefinitionByHandle.IsValidIndex(Handle.GetIndex()))
+	{
+		return CrimItemDefinitionRegistry::DefinitionByHandle[Handle.GetIndex()];
+	}
+	return FSoftObjectPath();
+}
+
+int32 UCrimItemDefinitionRegistry::GetNumHandles()
+{
+	FReadScopeLock ReadLock(CrimItemDefinitionRegistry::Lock);
+	return CrimItemDefinitionRegistry::DefinitionByHandle.Num();
+}
+
+void UCrimItemDefinitionRegistry::RegisterAllItemDefinitions()
+{
+	IAssetRegistry* AssetRegistry = IAssetRegistry::Get();
+	if (!AssetRegistry)
+	{
+		return;
+	}
+
+	TArray<FAssetData> AssetDataList;
+	AssetRegistry->GetAssetsByClass(UCrimItemDefinition::StaticClass()->GetClassPathName(), AssetDataList, true);
+
+	TArray<FSoftObjectPath> ItemDefinitions;
+	ItemDefinitions.Reserve(AssetDataList.Num());
+	for (const FAssetData& AssetData : AssetDataList)
+	{
+		ItemDefinitions.Add(AssetData.GetSoftObjectPath());
+	}
+	// Sorted so the handles of a given set of assets are the same from run to run, which makes them easier to debug.
+	ItemDefinitions.Sort([](const FSoftObjectPath& A, const FSoftObjectPath& B)
+	{
+		return A.LexicalLess(B);
+	});
+
+	FWriteScopeLock WriteLock(CrimItemDefinitionRegistry::Lock);
+	CrimItemDefinitionRegistry::HandleByDefinition.Reserve(CrimItemDefinitionRegistry::HandleByDefinition.Num() + ItemDefinitions.Num());
+	CrimItemDefinitionRegistry::DefinitionByHandle.Reserve(CrimItemDefinitionRegistry::DefinitionByHandle.Num() + ItemDefinitions.Num());
+	for (const FSoftObjectPath& ItemDefinition : ItemDefinitions)
+	{
+		if (!CrimItemDefinitionRegistry::HandleByDefinition.Contains(ItemDefinition))
+		{
+			const int32 Index = CrimItemDefinitionRegistry::DefinitionByHandle.Add(ItemDefinition);
+			CrimItemDefinitionRegistry::HandleByDefinition.Add(ItemDefinition, Index);
+		}
+	}
+}
@@ -5,7 +5,56 @@
 
 #include "ItemContainer/CrimItemContainer.h"
 #include "CrimItemDefinition.h"
+#include "CrimItemSystem.h"
+#include "Engine/NetConnection.h"
+#include "Engine/PackageMapClient.h"
+#include "Serialization/BitWriter.h"
 
+namespace CrimItemFastTypes
+{
+	/** Removes Index from the bucket of Key. Removes the bucket once it is empty. */
+	template<typename KeyType>
+	static void RemoveFromBucket(TMap<KeyType, TArray<int32>>& Map, const KeyType& Key, int32 Index)
+	{
+		if (TArray<int32>* Indices = Map.Find(Key))
+		{
+			Indices->RemoveSingle(Index);
+			if (Indices->Num() == 0)
+			{
+				Map.Remove(Key);
+			}
+		}
+	}
+
+	/** Replaces OldIndex with NewIndex in the Indices. */
+	static void MoveInBucket(TArray<int32>& Indices, int32 OldIndex, int32 NewIndex)
+	{
+		const int32 Slot = Indices.Find(OldIndex);
+		if (Slot != INDEX_NONE)
+		{
+			Indices[Slot] = NewIndex;
+		}
+	}
+
+	/** The number of ReplicationKeys each item remembers the changed sections of. */
+	static constexpr int32 MaxNetSectionHistory = 8;
+
+	/**
+	 * The ReplicationKey of each item, by ReplicationID, in the base state of the connection the ItemList is being
+	 * written for. Set by FFastCrimItemList::NetDeltaSerialize.
+	 */
+	static thread_local const TMap<int32, int32>* WritingBaseReplicationKeys = nullptr;
+
+	/** Replaces OldIndex with NewIndex in the bucket of Key. */
+	template<typename KeyType>
+	static void MoveInBucket(TMap<KeyType, TArray<int32>>& Map, const KeyType& Key, int32 OldIndex, int32 NewIndex)
+	{
+		if (TArray<int32>* Indices = Map.Find(Key))
+		{
+			MoveInBucket(*Indices, OldIndex, NewIndex);
+		}
+	}
+}
 
 //----------------------------------------------------------------------------------------
 // FastCrimItem
@@ -13,27 +62,207 @@
 void FFastCrimItem::Initialize(const TInstancedStruct<FCrimItem>& InItem)
 {
 	Item = InItem;
+	if (FCrimItem* ItemPtr = Item.GetMutablePtr<FCrimItem>())
+	{
+		ItemPtr->RefreshCachedState();
+	}
+}
 
-	// Make a copy of the Item for change comparison.
-	PreReplicatedChangeItem = InItem;
+void FFastCrimItem::Initialize(TInstancedStruct<FCrimItem>&& InItem)
+{
+	Item = MoveTemp(InItem);
+	if (FCrimItem* ItemPtr = Item.GetMutablePtr<FCrimItem>())
+	{
+		ItemPtr->RefreshCachedState();
+	}
 }
 
 void FFastCrimItem::PostReplicatedAdd(const FFastCrimItemList& InItemList)
 {
 	// Update our cached state.
-	PreReplicatedChangeItem = Item;
+	if (FCrimItem* ItemPtr = Item.GetMutablePtr<FCrimItem>())
+	{
+		// The owner pointers are transient and not replicated.
+		ItemPtr->ItemContainer = InItemList.OwningContainer;
+		ItemPtr->ItemManager = InItemList.OwningContainer.IsValid() ? InItemList.OwningContainer->GetItemManagerComponent() : nullptr;
+		ItemPtr->RefreshCachedState();
+	}
+	if (InItemList.bKeepPreReplicatedItems)
+	{
+		PreReplicatedChangeItem = Item;
+	}
+	InItemList.bIndexMapsDirty = true;
+
+	if (Item.IsValid())
+	{
+		const int32 PredictedIndex = InItemList.FindPredictedItemIndex(Item.Get<FCrimItem>().GetItemGuid());
+		if (PredictedIndex != INDEX_NONE)
+		{
+			// Replaces the Item this client predicted, which was already broadcast as added.
+			InItemList.PredictedItems.RemoveAtSwap(PredictedIndex, 1, EAllowShrinking::No);
+			InItemList.OnItemChangedDelegate.Broadcast(*this);
+			return;
+		}
+	}
 
 	InItemList.OnItemAddedDelegate.Broadcast(*this);
 }
 
 void FFastCrimItem::PostReplicatedChange(const FFastCrimItemList& InItemList)
 {
+	if (FCrimItem* ItemPtr = Item.GetMutablePtr<FCrimItem>())
+	{
+		// A full item received in place of the changed sections resets the owner pointers.
+		ItemPtr->ItemContainer = InItemList.OwningContainer;
+		ItemPtr->ItemManager = InItemList.OwningContainer.IsValid() ? InItemList.OwningContainer->GetItemManagerComponent() : nullptr;
+		ItemPtr->RefreshCachedState();
+	}
+	InItemList.bIndexMapsDirty = true;
 	InItemList.OnItemChangedDelegate.Broadcast(*this);
-	PreReplicatedChangeItem = Item;
+	if (InItemList.bKeepPreReplicatedItems)
+	{
+		PreReplicatedChangeItem = Item;
+	}
+}
+
+SIZE_T FFastCrimItem::GetAllocatedSize() const
+{
+	auto GetInstancedItemSize = [](const TInstancedStruct<FCrimItem>& InstancedItem) -> SIZE_T
+	{
+		const FCrimItem* ItemPtr = InstancedItem.GetPtr<FCrimItem>();
+		return ItemPtr ? InstancedItem.GetScriptStruct()->GetStructureSize() + ItemPtr->GetAllocatedSize() : 0;
+	};
+	return GetInstancedItemSize(Item) + GetInstancedItemSize(PreReplicatedChangeItem) + NetSectionHistory.GetAllocatedSize();
+}
+
+ECrimItemNetSection FFastCrimItem::GetNetSectionsChangedSince(int32 BaseReplicationKey) const
+{
+	ECrimItemNetSection Result = ECrimItemNetSection::None;
+	for (int32 i = NetSectionHistory.Num() - 1; i >= 0; i--)
+	{
+		if (NetSectionHistory[i].ReplicationKey <= BaseReplicationKey)
+		{
+			return Result;
+		}
+		Result |= NetSectionHistory[i].Sections;
+	}
+
+	// Every ReplicationKey after the base must have been recorded.
+	if (NetSectionHistory.Num() > 0 && NetSectionHistory[0].ReplicationKey == BaseReplicationKey + 1)
+	{
+		return Result;
+	}
+	return ECrimItemNetSection::All;
+}
+
+int32 FFastCrimItem::GetNetSizeEstimate() const
+{
+	if (NetSizeEstimate == INDEX_NONE || NetSizeReplicationKey != ReplicationKey)
+	{
+		NetSizeEstimate = 0;
+		if (Item.IsValid())
+		{
+			FBitWriter Writer(0, true);
+			bool bSuccess = true;
+			const_cast<FCrimItem&>(Item.Get<FCrimItem>()).NetSerialize(Writer, nullptr, bSuccess);
+			NetSizeEstimate = int32(Writer.GetNumBytes());
+		}
+		NetSizeReplicationKey = ReplicationKey;
+	}
+	return NetSizeEstimate;
+}
+
+bool FFastCrimItem::NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess)
+{
+	bOutSuccess = true;
+
+	// Connections that have an older version of the item only need the sections changed since.
+	ECrimItemNetSection Sections = ECrimItemNetSection::All;
+	if (Ar.IsSaving() && Item.IsValid() && CrimItemFastTypes::WritingBaseReplicationKeys)
+	{
+		if (const int32* BaseReplicationKey = CrimItemFastTypes::WritingBaseReplicationKeys->Find(ReplicationID))
+		{
+			Sections = GetNetSectionsChangedSince(*BaseReplicationKey);
+		}
+	}
+	uint8 bSectionsOnly = Sections != ECrimItemNetSection::All;
+	Ar.SerializeBits(&bSectionsOnly, 1);
+	if (bSectionsOnly)
+	{
+		if (!Item.IsValid())
+		{
+			Ar.SetError();
+			bOutSuccess = false;
+			return false;
+		}
+		// Applied in place, so the change is visible by the time PostReplicatedChange is called.
+		return Item.GetMutable<FCrimItem>().NetSerializeSections(Ar, Map, Sections, bOutSuccess);
+	}
+
+	UObject* ItemStruct = const_cast<UScriptStruct*>(Item.GetScriptStruct());
+	uint8 bIsValid = ItemStruct != nullptr;
+	Ar.SerializeBits(&bIsValid, 1);
+	if (!bIsValid)
+	{
+		if (Ar.IsLoading())
+		{
+			Item.Reset();
+		}
+		return true;
+	}
+
+	// Most items use the base struct, which only costs a bit.
+	uint8 bIsBaseStruct = ItemStruct == FCrimItem::StaticStruct();
+	Ar.SerializeBits(&bIsBaseStruct, 1);
+	if (bIsBaseStruct)
+	{
+		ItemStruct = FCrimItem::StaticStruct();
+	}
+	else if (Map)
+	{
+		Map->SerializeObject(Ar, UScriptStruct::StaticClass(), ItemStruct);
+	}
+
+	const UScriptStruct* Struct = Cast<UScriptStruct>(ItemStruct);
+	if (!Struct || !Struct->IsChildOf(FCrimItem::StaticStruct()))
+	{
+		// The rest of the item can not be read without knowing its layout.
+		Ar.SetError();
+		bOutSuccess = false;
+		return false;
+	}
+	if (Ar.IsLoading() && Item.GetScriptStruct() != Struct)
+	{
+		Item.InitializeAsScriptStruct(Struct);
+	}
+
+	FCrimItem& ItemRef = Item.GetMutable<FCrimItem>();
+	bool bItemSuccess = true;
+	ItemRef.NetSerialize(Ar, Map, bItemSuccess);
+	bOutSuccess &= bItemSuccess;
+
+	// Replicated properties declared by child structs.
+	if (Struct != FCrimItem::StaticStruct())
+	{
+		for (TFieldIterator<FProperty> It(Struct); It; ++It)
+		{
+			if (It->GetOwnerStruct() == FCrimItem::StaticStruct() || It->HasAnyPropertyFlags(CPF_RepSkip))
+			{
+				continue;
+			}
+			for (int32 ArrayIndex = 0; ArrayIndex < It->GetArrayDim(); ArrayIndex++)
+			{
+				bOutSuccess &= It->NetSerializeItem(Ar, Map, It->ContainerPtrToValuePtr<void>(&ItemRef, ArrayIndex));
+			}
+		}
+	}
+
+	return true;
 }
 
 void FFastCrimItem::PreReplicatedRemove(const FFastCrimItemList& InItemList)
 {
+	InItemList.bIndexMapsDirty = true;
 	InItemList.OnItemRemovedDelegate.Broadcast(*this);
 }
 
@@ -42,32 +271,109 @@ void FFastCrimItem::PreReplicatedRemove(const FFastCrimItemList& InItemList)
 //----------------------------------------------------------------------------------------
 
 void FFastCrimItemList::AddItem(const TInstancedStruct<FCrimItem>& Item)
+{
+	AddItem(TInstancedStruct<FCrimItem>(Item));
+}
+
+void FFastCrimItemList::AddItem(TInstancedStruct<FCrimItem>&& Item)
 {
 	check(Item.IsValid());
 
-	FFastCrimItem& NewItem = Items.AddDefaulted_GetRef();
-	NewItem.Initialize(Item);
+	++Version;
+	const int32 NewIndex = Items.AddDefaulted();
+	FFastCrimItem& NewItem = Items[NewIndex];
+	NewItem.Initialize(MoveTemp(Item));
+	NewItem.NetPriority = ++LastNetPriority;
+	if (bKeepPreReplicatedItems)
+	{
+		// Make a copy of the Item for change comparison.
+		NewItem.PreReplicatedChangeItem = NewItem.Item;
+	}
+	if (!bIndexMapsDirty && ItemSignatures.Num() == NewIndex)
+	{
+		AddToIndexMaps(NewIndex);
+	}
+	else
+	{
+		bIndexMapsDirty = true;
+	}
+
+#if DO_CHECK && !UE_BUILD_SHIPPING
+	ValidateIndexMaps();
+#endif
 
 	OnItemAddedDelegate.Broadcast(NewItem);
 	MarkItemDirty(NewItem);
 }
 
-bool FFastCrimItemList::RemoveItem(const FGuid& ItemGuid)
+void FFastCrimItemList::AddPredictedItem(TInstancedStruct<FCrimItem>&& Item)
 {
-	for (int32 i = Items.Num() - 1; i >= 0; i--)
+	check(Item.IsValid());
+
+	// Kept out of the Items, only the server assigns ReplicationIDs.
+	++Version;
+	FFastCrimItem& NewItem = PredictedItems.AddDefaulted_GetRef();
+	NewItem.Initialize(MoveTemp(Item));
+	if (bKeepPreReplicatedItems)
 	{
-		const FCrimItem* ItemPtr = Items[i].Item.GetPtr<FCrimItem>();
-		if (ItemPtr && ItemPtr->GetItemGuid() == ItemGuid)
-		{
-			FFastCrimItem OldItem = Items[i];
-			Items.RemoveAtSwap(i);
+		NewItem.PreReplicatedChangeItem = NewItem.Item;
+	}
 
-			OnItemRemovedDelegate.Broadcast(OldItem);
-			MarkArrayDirty();
-			return true;
-		}
+	OnItemAddedDelegate.Broadcast(NewItem);
+}
+
+bool FFastCrimItemList::RemovePredictedItem(const FGuid& ItemGuid)
+{
+	const int32 Index = FindPredictedItemIndex(ItemGuid);
+	if (Index == INDEX_NONE)
+	{
+		return false;
+	}
+
+	++Version;
+	const FFastCrimItem OldItem = MoveTemp(PredictedItems[Index]);
+	PredictedItems.RemoveAtSwap(Index, 1, EAllowShrinking::No);
+	OnItemRemovedDelegate.Broadcast(OldItem);
+	return true;
+}
+
+bool FFastCrimItemList::HasPredictedItem(const FGuid& ItemGuid) const
+{
+	return FindPredictedItemIndex(ItemGuid) != INDEX_NONE;
+}
+
+int32 FFastCrimItemList::FindPredictedItemIndex(const FGuid& ItemGuid) const
+{
+	return PredictedItems.IndexOfByPredicate([&ItemGuid](const FFastCrimItem& FastItem)
+	{
+		return FastItem.Item.Get<FCrimItem>().GetItemGuid() == ItemGuid;
+	});
+}
+
+bool FFastCrimItemList::RemoveItem(const FGuid& ItemGuid)
+{
+	TInstancedStruct<FCrimItem> RemovedItem;
+	return RemoveItem(ItemGuid, RemovedItem);
+}
+
+bool FFastCrimItemList::RemoveItem(const FGuid& ItemGuid, TInstancedStruct<FCrimItem>& OutItem)
+{
+	const int32 Index = FindItemIndex(ItemGuid);
+	if (Index == INDEX_NONE)
+	{
+		return false;
 	}
-	return false;
+
+	FFastCrimItem OldItem;
+	RemoveItemAt(Index, &OldItem);
+#if DO_CHECK && !UE_BUILD_SHIPPING
+	ValidateIndexMaps();
+#endif
+
+	OnItemRemovedDelegate.Broadcast(OldItem);
+	MarkArrayDirty();
+	OutItem = MoveTemp(OldItem.Item);
+	return true;
 }
 
 const TArray<FFastCrimItem>& FFastCrimItemList::GetItems() const
@@ -77,26 +383,497 @@ const TArray<FFastCrimItem>& FFastCrimItemList::GetItems() const
 
 FFastCrimItem* FFastCrimItemList::GetItem(const FGuid& ItemGuid) const
 {
-	for (const FFastCrimItem& Item : Items)
+	const int32 Index = FindItemIndex(ItemGuid);
+	if (Index == INDEX_NONE)
 	{
-		const FCrimItem* ItemPtr = Item.Item.GetPtr<FCrimItem>();
-		if (ItemPtr && ItemPtr->GetItemGuid() == ItemGuid)
+		const int32 PredictedIndex = FindPredictedItemIndex(ItemGuid);
+		return PredictedIndex != INDEX_NONE ? &PredictedItems[PredictedIndex] : nullptr;
+	}
+	return const_cast<FFastCrimItem*>(&Items[Index]);
+}
+
+void FFastCrimItemList::ForEachItem(TFunctionRef<bool(FFastCrimItem&)> Func) const
+{
+	for (const FFastCrimItem& Entry : Items)
+	{
+		if (!Func(const_cast<FFastCrimItem&>(Entry)))
 		{
-			return const_cast<FFastCrimItem*>(&Item);
+			return;
 		}
 	}
-	return nullptr;
+	for (FFastCrimItem& Entry : PredictedItems)
+	{
+		if (!Func(Entry))
+		{
+			return;
+		}
+	}
+}
+
+void FFastCrimItemList::ForEachItemByDefinition(FCrimItemDefinitionHandle ItemDefinition, TFunctionRef<bool(FFastCrimItem&)> Func) const
+{
+	ConditionalRebuildIndexMaps();
+
+	const int32 DefinitionId = FindDefinitionId(ItemDefinition);
+	if (DefinitionId != INDEX_NONE)
+	{
+		for (const int32 Index : ItemIndicesByDefinition[DefinitionId])
+		{
+			if (!Func(const_cast<FFastCrimItem&>(Items[Index])))
+			{
+				return;
+			}
+		}
+	}
+	for (FFastCrimItem& Entry : PredictedItems)
+	{
+		if (Entry.Item.Get<FCrimItem>().GetItemDefinitionHandle() == ItemDefinition && !Func(Entry))
+		{
+			return;
+		}
+	}
+}
+
+void FFastCrimItemList::ForEachMatchingItem(const TInstancedStruct<FCrimItem>& TestItem, TFunctionRef<bool(FFastCrimItem&)> Func) const
+{
+	if (!TestItem.IsValid())
+	{
+		return;
+	}
+
+	ConditionalRebuildIndexMaps();
+#if DO_CHECK && !UE_BUILD_SHIPPING
+	ValidateStackSignatures(TestItem);
+#endif
+
+	if (!TestItem.Get<FCrimItem>().UsesStackSignature())
+	{
+		for (int32 Index = 0; Index < Items.Num(); Index++)
+		{
+			if (Items[Index].Item.Get<FCrimItem>().IsMatching(TestItem) &&
+				!Func(const_cast<FFastCrimItem&>(Items[Index])))
+			{
+				return;
+			}
+		}
+	}
+	else if (const TArray<int32>* Bucket = ItemSignatureMap.Find(TestItem.Get<FCrimItem>().GetStackSignature()))
+	{
+		// Func may change an Item's signature, which moves it between the buckets and can free this one.
+		const TArray<int32, TInlineAllocator<16>> Indices(*Bucket);
+		for (const int32 Index : Indices)
+		{
+			if (Items[Index].Item.Get<FCrimItem>().IsMatching(TestItem) &&
+				!Func(const_cast<FFastCrimItem&>(Items[Index])))
+			{
+				return;
+			}
+		}
+	}
+	for (FFastCrimItem& Entry : PredictedItems)
+	{
+		if (Entry.Item.Get<FCrimItem>().IsMatching(TestItem) && !Func(Entry))
+		{
+			return;
+		}
+	}
+}
+
+void FFastCrimItemList::ForEachMatchingItemBelowQuantity(const TInstancedStruct<FCrimItem>& TestItem, int32 MaxQuantity,
+	TFunctionRef<bool(FFastCrimItem&)> Func) const
+{
+	if (!TestItem.IsValid())
+	{
+		return;
+	}
+
+	ConditionalRebuildIndexMaps();
+#if DO_CHECK && !UE_BUILD_SHIPPING
+	ValidateStackSignatures(TestItem);
+#endif
+
+	if (!TestItem.Get<FCrimItem>().UsesStackSignature())
+	{
+		for (int32 Index = 0; Index < Items.Num(); Index++)
+		{
+			if (ItemQuantities[Index] < MaxQuantity &&
+				Items[Index].Item.Get<FCrimItem>().IsMatching(TestItem) &&
+				!Func(const_cast<FFastCrimItem&>(Items[Index])))
+			{
+				return;
+			}
+		}
+	}
+	else if (const TArray<int32>* Bucket = ItemSignatureMap.Find(TestItem.Get<FCrimItem>().GetStackSignature()))
+	{
+		// Func may change an Item's signature, which moves it between the buckets and can free this one.
+		const TArray<int32, TInlineAllocator<16>> Indices(*Bucket);
+		for (const int32 Index : Indices)
+		{
+			if (ItemQuantities[Index] < MaxQuantity &&
+				Items[Index].Item.Get<FCrimItem>().IsMatching(TestItem) &&
+				!Func(const_cast<FFastCrimItem&>(Items[Index])))
+			{
+				return;
+			}
+		}
+	}
+	for (FFastCrimItem& Entry : PredictedItems)
+	{
+		const FCrimItem& Item = Entry.Item.Get<FCrimItem>();
+		if (Item.Quantity < MaxQuantity && Item.IsMatching(TestItem) && !Func(Entry))
+		{
+			return;
+		}
+	}
+}
+
+FFastCrimItem* FFastCrimItemList::GetItemByDefinition(FCrimItemDefinitionHandle ItemDefinition) const
+{
+	FFastCrimItem* Result = nullptr;
+	ForEachItemByDefinition(ItemDefinition, [&Result](FFastCrimItem& FastItem)
+	{
+		Result = &FastItem;
+		return false;
+	});
+	return Result;
+}
+
+TArray<FFastCrimItem*> FFastCrimItemList::GetItemsByDefinition(FCrimItemDefinitionHandle ItemDefinition) const
+{
+	TArray<FFastCrimItem*> Result;
+	ForEachItemByDefinition(ItemDefinition, [&Result](FFastCrimItem& FastItem)
+	{
+		Result.Add(&FastItem);
+		return true;
+	});
+	return Result;
+}
+
+FFastCrimItem* FFastCrimItemList::FindMatchingItem(const TInstancedStruct<FCrimItem>& TestItem) const
+{
+	FFastCrimItem* Result = nullptr;
+	ForEachMatchingItem(TestItem, [&Result](FFastCrimItem& FastItem)
+	{
+		Result = &FastItem;
+		return false;
+	});
+	return Result;
+}
+
+TArray<FFastCrimItem*> FFastCrimItemList::FindMatchingItems(const TInstancedStruct<FCrimItem>& TestItem) const
+{
+	TArray<FFastCrimItem*> Result;
+	ForEachMatchingItem(TestItem, [&Result](FFastCrimItem& FastItem)
+	{
+		Result.Add(&FastItem);
+		return true;
+	});
+	return Result;
+}
+
+int32 FFastCrimItemList::GetStackCountByDefinition(FCrimItemDefinitionHandle ItemDefinition) const
+{
+	ConditionalRebuildIndexMaps();
+
+	const int32 DefinitionId = FindDefinitionId(ItemDefinition);
+	int32 Result = DefinitionId != INDEX_NONE ? ItemIndicesByDefinition[DefinitionId].Num() : 0;
+	for (const FFastCrimItem& Entry : PredictedItems)
+	{
+		Result += Entry.Item.Get<FCrimItem>().GetItemDefinitionHandle() == ItemDefinition ? 1 : 0;
+	}
+	return Result;
+}
+
+int32 FFastCrimItemList::GetQuantityByDefinition(FCrimItemDefinitionHandle ItemDefinition) const
+{
+	ConditionalRebuildIndexMaps();
+
+	const int32 DefinitionId = FindDefinitionId(ItemDefinition);
+	int32 Result = DefinitionId != INDEX_NONE ? QuantityByDefinition[DefinitionId] : 0;
+	for (const FFastCrimItem& Entry : PredictedItems)
+	{
+		const FCrimItem& Item = Entry.Item.Get<FCrimItem>();
+		Result += Item.GetItemDefinitionHandle() == ItemDefinition ? Item.Quantity : 0;
+	}
+	return Result;
+}
+
+bool FFastCrimItemList::NetDeltaSerialize(FNetDeltaSerializeInfo& DeltaParams)
+{
+	// Replays are excluded since they can be scrubbed to a state other than the one the delta was written against.
+	const TMap<int32, int32>* BaseReplicationKeys = nullptr;
+	if (DeltaParams.Writer && DeltaParams.OldState && !DeltaParams.bInternalAck)
+	{
+		BaseReplicationKeys = &static_cast<const FNetFastArrayBaseState*>(DeltaParams.OldState)->IDToCLMap;
+	}
+	TGuardValue<const TMap<int32, int32>*> BaseReplicationKeysGuard(CrimItemFastTypes::WritingBaseReplicationKeys, BaseReplicationKeys);
+
+	HeldBackItemIDs.Reset();
+	if (DeltaParams.Writer && !DeltaParams.bInternalAck && (MaxNewItemsPerNetUpdate > 0 || MaxNewItemBytesPerNetUpdate > 0))
+	{
+		const UPackageMapClient* PackageMap = Cast<UPackageMapClient>(DeltaParams.Map);
+		UpdateNetBacklogStats(PackageMap ? PackageMap->GetConnection() : nullptr, SelectHeldBackItems(BaseReplicationKeys, HeldBackItemIDs));
+	}
+	if (HeldBackItemIDs.IsEmpty())
+	{
+		return FastArrayDeltaSerialize<FFastCrimItem, FFastCrimItemList>(Items, DeltaParams, *this);
+	}
+
+	// The cached item counts depend on which items are written, which now differs per connection. Only the counts are
+	// reset, the ArrayReplicationKey stays so the other connections still skip the array when nothing changed for them.
+	CachedNumItems = INDEX_NONE;
+	CachedNumItemsToConsiderForWriting = INDEX_NONE;
+	const bool bResult = FastArrayDeltaSerialize<FFastCrimItem, FFastCrimItemList>(Items, DeltaParams, *this);
+	CachedNumItems = INDEX_NONE;
+	CachedNumItemsToConsiderForWriting = INDEX_NONE;
+	HeldBackItemIDs.Reset();
+
+	// The held back Items are missing from the IDToCLMap of this connection's new state. Its ArrayReplicationKey is
+	// cleared so the next update compares the per item keys, finds them missing and sends them then.
+	if (DeltaParams.NewState && DeltaParams.NewState->IsValid())
+	{
+		static_cast<FNetFastArrayBaseState*>(DeltaParams.NewState->Get())->ArrayReplicationKey = INDEX_NONE;
+	}
+	return bResult;
+}
+
+int32 FFastCrimItemList::SelectHeldBackItems(const TMap<int32, int32>* BaseReplicationKeys, TSet<int32>& OutHeldBackItemIDs) const
+{
+	OutHeldBackItemIDs.Reset();
+
+	TArray<const FFastCrimItem*> NewItems;
+	for (const FFastCrimItem& FastItem : Items)
+	{
+		if (FastItem.ReplicationID != INDEX_NONE && (!BaseReplicationKeys || !BaseReplicationKeys->Contains(FastItem.ReplicationID)))
+		{
+			NewItems.Add(&FastItem);
+		}
+	}
+	if (MaxNewItemBytesPerNetUpdate <= 0 && NewItems.Num() <= MaxNewItemsPerNetUpdate)
+	{
+		return 0;
+	}
+
+	NewItems.Sort([](const FFastCrimItem& A, const FFastCrimItem& B)
+	{
+		return A.NetPriority > B.NetPriority;
+	});
+
+	// The Items are sent in priority order, so once one does not fit all the ones after it are held back as well.
+	int32 NumSent = 0;
+	int32 NumBytesSent = 0;
+	for (; NumSent < NewItems.Num(); NumSent++)
+	{
+		if (MaxNewItemsPerNetUpdate > 0 && NumSent >= MaxNewItemsPerNetUpdate)
+		{
+			break;
+		}
+		if (MaxNewItemBytesPerNetUpdate > 0)
+		{
+			NumBytesSent += NewItems[NumSent]->GetNetSizeEstimate();
+			if (NumSent > 0 && NumBytesSent > MaxNewItemBytesPerNetUpdate)
+			{
+				break;
+			}
+		}
+	}
+
+	const int32 Backlog = NewItems.Num() - NumSent;
+	OutHeldBackItemIDs.Reserve(Backlog);
+	for (int32 i = NumSent; i < NewItems.Num(); i++)
+	{
+		OutHeldBackItemIDs.Add(NewItems[i]->ReplicationID);
+	}
+
+	if (Backlog > 0)
+	{
+		UE_LOG(LogCrimItemSystem, Verbose, TEXT("FFastCrimItemList: Held back %d of %d new items over the budget of %d items and %d bytes per net update."),
+			Backlog, NewItems.Num(), MaxNewItemsPerNetUpdate, MaxNewItemBytesPerNetUpdate);
+	}
+	return Backlog;
+}
+
+void FFastCrimItemList::UpdateNetBacklogStats(const UNetConnection* Connection, int32 Backlog)
+{
+	if (Backlog > 0)
+	{
+		BacklogByConnection.Add(Connection, Backlog);
+		NetBacklogStats.PeakBacklog = FMath::Max(NetBacklogStats.PeakBacklog, Backlog);
+		NetBacklogStats.NumThrottledUpdates++;
+	}
+	else if (BacklogByConnection.Remove(Connection) == 0)
+	{
+		// Nothing changed for the stats.
+		return;
+	}
+
+	NetBacklogStats.CurrentBacklog = 0;
+	for (auto It = BacklogByConnection.CreateIterator(); It; ++It)
+	{
+		// Closed connections never get another update to clear their backlog. Writes without a known connection share
+		// the null key.
+		if (It.Key() != TObjectKey<UNetConnection>() && It.Key().ResolveObjectPtr() == nullptr)
+		{
+			It.RemoveCurrent();
+			continue;
+		}
+		NetBacklogStats.CurrentBacklog = FMath::Max(NetBacklogStats.CurrentBacklog, It.Value());
+	}
+	NetBacklogStats.NumBackloggedConnections = BacklogByConnection.Num();
+}
+
+void FFastCrimItemList::SetMaxNewItemsPerNetUpdate(int32 MaxItems)
+{
+	MaxNewItemsPerNetUpdate = FMath::Max(MaxItems, 0);
+}
+
+int32 FFastCrimItemList::GetMaxNewItemsPerNetUpdate() const
+{
+	return MaxNewItemsPerNetUpdate;
+}
+
+void FFastCrimItemList::SetMaxNewItemBytesPerNetUpdate(int32 MaxBytes)
+{
+	MaxNewItemBytesPerNetUpdate = FMath::Max(MaxBytes, 0);
+}
+
+int32 FFastCrimItemList::GetMaxNewItemBytesPerNetUpdate() const
+{
+	return MaxNewItemBytesPerNetUpdate;
+}
+
+void FFastCrimItemList::PrioritizeItemReplication(FFastCrimItem& FastItem)
+{
+	FastItem.NetPriority = ++LastNetPriority;
+}
+
+const FCrimItemNetBacklogStats& FFastCrimItemList::GetNetBacklogStats() const
+{
+	return NetBacklogStats;
+}
+
+void FFastCrimItemList::MarkItemSectionsDirty(FFastCrimItem& FastItem, ECrimItemNetSection Sections)
+{
+	MarkItemDirty(FastItem);
+
+	if (FastItem.NetSectionHistory.Num() == CrimItemFastTypes::MaxNetSectionHistory)
+	{
+		FastItem.NetSectionHistory.RemoveAt(0, 1, EAllowShrinking::No);
+	}
+	FastItem.NetSectionHistory.Add({FastItem.ReplicationKey, Sections});
+}
+
+void FFastCrimItemList::RefreshItemIndex(const FFastCrimItem& FastItem)
+{
+	++Version;
+	if (&FastItem < Items.GetData() || &FastItem >= Items.GetData() + Items.Num())
+	{
+		// A predicted Item, which is not in the lookup maps.
+		return;
+	}
+	const int32 Index = UE_PTRDIFF_TO_INT32(&FastItem - Items.GetData());
+	if (bIndexMapsDirty || !Items.IsValidIndex(Index) || !ItemSignatures.IsValidIndex(Index))
+	{
+		bIndexMapsDirty = true;
+		return;
+	}
+
+	const FCrimItem& Item = FastItem.Item.Get<FCrimItem>();
+	const uint64 NewSignature = Item.GetStackSignature();
+	if (ItemSignatures[Index] != NewSignature)
+	{
+		CrimItemFastTypes::RemoveFromBucket(ItemSignatureMap, ItemSignatures[Index], Index);
+		ItemSignatureMap.FindOrAdd(NewSignature).Add(Index);
+		ItemSignatures[Index] = NewSignature;
+	}
+
+	if (ItemQuantities[Index] != Item.Quantity)
+	{
+		QuantityByDefinition[ItemDefinitionIds[Index]] += Item.Quantity - ItemQuantities[Index];
+		ItemQuantities[Index] = Item.Quantity;
+	}
+
+#if DO_CHECK && !UE_BUILD_SHIPPING
+	ValidateIndexMaps();
+#endif
 }
 
 int32 FFastCrimItemList::GetNum() const
 {
-	return Items.Num();
+	return Items.Num() + PredictedItems.Num();
+}
+
+uint32 FFastCrimItemList::GetVersion() const
+{
+	return Version;
+}
+
+SIZE_T FFastCrimItemList::GetAllocatedSize() const
+{
+	SIZE_T Result = Items.GetAllocatedSize() +
+		ItemGuids.GetAllocatedSize() +
+		ItemDefinitionIds.GetAllocatedSize() +
+		ItemSignatures.GetAllocatedSize() +
+		ItemQuantities.GetAllocatedSize() +
+		ItemGuidMap.GetAllocatedSize() +
+		DefinitionIds.GetAllocatedSize() +
+		ItemIndicesByDefinition.GetAllocatedSize() +
+		QuantityByDefinition.GetAllocatedSize() +
+		ItemSignatureMap.GetAllocatedSize() +
+		PredictedItems.GetAllocatedSize();
+	for (const FFastCrimItem& FastItem : Items)
+	{
+		Result += FastItem.GetAllocatedSize();
+	}
+	for (const FFastCrimItem& FastItem : PredictedItems)
+	{
+		Result += FastItem.GetAllocatedSize();
+	}
+	for (const TArray<int32>& Indices : ItemIndicesByDefinition)
+	{
+		Result += Indices.GetAllocatedSize();
+	}
+	for (const TTuple<uint64, TArray<int32>>& Pair : ItemSignatureMap)
+	{
+		Result += Pair.Value.GetAllocatedSize();
+	}
+	return Result;
+}
+
+void FFastCrimItemList::SetOwningContainer(UCrimItemContainerBase* ItemContainer)
+{
+	OwningContainer = ItemContainer;
+}
+
+void FFastCrimItemList::SetKeepPreReplicatedItems(bool bKeep)
+{
+	bKeepPreReplicatedItems = bKeep;
+}
+
+bool FFastCrimItemList::IsKeepingPreReplicatedItems() const
+{
+	return bKeepPreReplicatedItems;
 }
 
 void FFastCrimItemList::Reset()
 {
-	TArray<FFastCrimItem> TempEntries = Items;
+	// Moving the Items out frees them in bulk once the removals have been broadcast.
+	TArray<FFastCrimItem> TempEntries = MoveTemp(Items);
+	TempEntries.Append(MoveTemp(PredictedItems));
+	++Version;
 	Items.Empty();
+	PredictedItems.Empty();
+	ItemGuids.Empty();
+	ItemDefinitionIds.Empty();
+	ItemSignatures.Empty();
+	ItemQuantities.Empty();
+	ItemGuidMap.Empty();
+	DefinitionIds.Empty();
+	ItemIndicesByDefinition.Empty();
+	QuantityByDefinition.Empty();
+	ItemSignatureMap.Empty();
+	bIndexMapsDirty = false;
 	for (FFastCrimItem& Entry : TempEntries)
 	{
 		OnItemRemovedDelegate.Broadcast(Entry);
@@ -104,6 +881,245 @@ void FFastCrimItemList::Reset()
 	MarkArrayDirty();
 }
 
+void FFastCrimItemList::Reserve(int32 Number)
+{
+	if (Number <= Items.Max())
+	{
+		return;
+	}
+
+	// Growing the Items moves them, invalidating pointers to them.
+	++Version;
+	Items.Reserve(Number);
+	ItemGuids.Reserve(Number);
+	ItemDefinitionIds.Reserve(Number);
+	ItemSignatures.Reserve(Number);
+	ItemQuantities.Reserve(Number);
+	ItemGuidMap.Reserve(Number);
+}
+
+void FFastCrimItemList::ConditionalShrink()
+{
+	const int32 Capacity = Items.Max();
+	if (Capacity <= MinShrinkCapacity || Items.Num() >= Capacity / 4)
+	{
+		return;
+	}
+
+	// Shrinking moves the Items, invalidating pointers to them.
+	++Version;
+	Items.Shrink();
+	ItemGuids.Shrink();
+	ItemDefinitionIds.Shrink();
+	ItemSignatures.Shrink();
+	ItemQuantities.Shrink();
+	ItemGuidMap.Compact();
+	ItemGuidMap.Shrink();
+	ItemSignatureMap.Compact();
+	ItemSignatureMap.Shrink();
+}
+
+void FFastCrimItemList::SetMinShrinkCapacity(int32 Capacity)
+{
+	MinShrinkCapacity = FMath::Max(Capacity, 0);
+}
+
+int32 FFastCrimItemList::GetMinShrinkCapacity() const
+{
+	return MinShrinkCapacity;
+}
+
+void FFastCrimItemList::PostReplicatedReceive(const FFastArraySerializer::FPostReplicatedReceiveParameters& Parameters)
+{
+	// Removed items are only erased from the array after the item callbacks have fired.
+	bIndexMapsDirty = true;
+	++Version;
+}
+
+void FFastCrimItemList::ConditionalRebuildIndexMaps() const
+{
+	if (!bIndexMapsDirty && ItemGuidMap.Num() == Items.Num() && ItemSignatures.Num() == Items.Num())
+	{
+		return;
+	}
+
+	ItemGuids.Reset(Items.Num());
+	ItemDefinitionIds.Reset(Items.Num());
+	ItemSignatures.Reset(Items.Num());
+	ItemQuantities.Reset(Items.Num());
+	ItemGuidMap.Reset();
+	ItemGuidMap.Reserve(Items.Num());
+	DefinitionIds.Reset();
+	ItemIndicesByDefinition.Reset();
+	QuantityByDefinition.Reset();
+	ItemSignatureMap.Reset();
+	for (int32 i = 0; i < Items.Num(); i++)
+	{
+		AddToIndexMaps(i);
+	}
+	bIndexMapsDirty = false;
+}
+
+void FFastCrimItemList::AddToIndexMaps(int32 Index) const
+{
+	check(ItemSignatures.Num() == Index);
+
+	const FCrimItem* ItemPtr = Items[Index].Item.GetPtr<FCrimItem>();
+	if (ItemPtr == nullptr)
+	{
+		ItemGuids.AddDefaulted();
+		ItemDefinitionIds.Add(INDEX_NONE);
+		ItemSignatures.Add(0);
+		ItemQuantities.Add(0);
+		return;
+	}
+
+	const uint64 Signature = ItemPtr->GetStackSignature();
+	const int32 DefinitionId = FindOrAddDefinitionId(ItemPtr->GetItemDefinitionHandle());
+	ItemGuids.Add(ItemPtr->GetItemGuid());
+	ItemDefinitionIds.Add(DefinitionId);
+	ItemSignatures.Add(Signature);
+	ItemQuantities.Add(ItemPtr->Quantity);
+
+	ItemGuidMap.Add(ItemPtr->GetItemGuid(), Index);
+	ItemIndicesByDefinition[DefinitionId].Add(Index);
+	QuantityByDefinition[DefinitionId] += ItemPtr->Quantity;
+	ItemSignatureMap.FindOrAdd(Signature).Add(Index);
+}
+
+int32 FFastCrimItemList::FindDefinitionId(FCrimItemDefinitionHandle ItemDefinition) const
+{
+	const int32* DefinitionId = DefinitionIds.Find(ItemDefinition);
+	return DefinitionId ? *DefinitionId : INDEX_NONE;
+}
+
+int32 FFastCrimItemList::FindOrAddDefinitionId(FCrimItemDefinitionHandle ItemDefinition) const
+{
+	if (const int32* DefinitionId = DefinitionIds.Find(ItemDefinition))
+	{
+		return *DefinitionId;
+	}
+
+	const int32 DefinitionId = ItemIndicesByDefinition.AddDefaulted();
+	QuantityByDefinition.Add(0);
+	DefinitionIds.Add(ItemDefinition, DefinitionId);
+	return DefinitionId;
+}
+
+int32 FFastCrimItemList::FindItemIndex(const FGuid& ItemGuid) const
+{
+	ConditionalRebuildIndexMaps();
+
+	const int32* IndexPtr = ItemGuidMap.Find(ItemGuid);
+	if (IndexPtr == nullptr)
+	{
+		return INDEX_NONE;
+	}
+
+	// Guard against a client side array that was rearranged after the last rebuild.
+	const FCrimItem* ItemPtr = Items.IsValidIndex(*IndexPtr) ? Items[*IndexPtr].Item.GetPtr<FCrimItem>() : nullptr;
+	if (ItemPtr == nullptr || ItemPtr->GetItemGuid() != ItemGuid)
+	{
+		bIndexMapsDirty = true;
+		ConditionalRebuildIndexMaps();
+		IndexPtr = ItemGuidMap.Find(ItemGuid);
+		return IndexPtr ? *IndexPtr : INDEX_NONE;
+	}
+	return *IndexPtr;
+}
+
+void FFastCrimItemList::RemoveItemAt(int32 Index, FFastCrimItem* OutRemovedItem)
+{
+	++Version;
+	const int32 LastIndex = Items.Num() - 1;
+
+	ItemGuidMap.Remove(ItemGuids[Index]);
+	CrimItemFastTypes::RemoveFromBucket(ItemSignatureMap, ItemSignatures[Index], Index);
+	if (const int32 DefinitionId = ItemDefinitionIds[Index]; DefinitionId != INDEX_NONE)
+	{
+		ItemIndicesByDefinition[DefinitionId].RemoveSingle(Index);
+		QuantityByDefinition[DefinitionId] -= ItemQuantities[Index];
+	}
+
+	if (Index != LastIndex)
+	{
+		// The last item is about to be swapped into the removed slot.
+		ItemGuidMap.Add(ItemGuids[LastIndex], Index);
+		if (const int32 DefinitionId = ItemDefinitionIds[LastIndex]; DefinitionId != INDEX_NONE)
+		{
+			CrimItemFastTypes::MoveInBucket(ItemIndicesByDefinition[DefinitionId], LastIndex, Index);
+		}
+		CrimItemFastTypes::MoveInBucket(ItemSignatureMap, ItemSignatures[LastIndex], LastIndex, Index);
+	}
+	if (OutRemovedItem)
+	{
+		*OutRemovedItem = MoveTemp(Items[Index]);
+	}
+	// Keep the memory around for the next items added, the owning container calls ConditionalShrink once it is safe.
+	Items.RemoveAtSwap(Index, 1, EAllowShrinking::No);
+	ItemGuids.RemoveAtSwap(Index, 1, EAllowShrinking::No);
+	ItemDefinitionIds.RemoveAtSwap(Index, 1, EAllowShrinking::No);
+	ItemSignatures.RemoveAtSwap(Index, 1, EAllowShrinking::No);
+	ItemQuantities.RemoveAtSwap(Index, 1, EAllowShrinking::No);
+}
+
+#if DO_CHECK && !UE_BUILD_SHIPPING
+void FFastCrimItemList::ValidateIndexMaps() const
+{
+	if (!CrimItemSystem::IsItemIndexValidationEnabled() || bIndexMapsDirty)
+	{
+		return;
+	}
+
+	check(ItemGuidMap.Num() == Items.Num());
+	check(ItemGuids.Num() == Items.Num());
+	check(ItemDefinitionIds.Num() == Items.Num());
+	check(ItemSignatures.Num() == Items.Num());
+	check(ItemQuantities.Num() == Items.Num());
+
+	TArray<int32> StackCounts;
+	TArray<int32> Quantities;
+	StackCounts.SetNumZeroed(ItemIndicesByDefinition.Num());
+	Quantities.SetNumZeroed(QuantityByDefinition.Num());
+	for (int32 i = 0; i < Items.Num(); i++)
+	{
+		const FCrimItem& Item = Items[i].Item.Get<FCrimItem>();
+		const int32 DefinitionId = ItemDefinitionIds[i];
+		checkf(ItemGuids[i] == Item.GetItemGuid() && ItemGuidMap.FindRef(Item.GetItemGuid()) == i, TEXT("ItemGuidMap is out of date for %s"), *Item.GetItemGuid().ToString());
+		checkf(DefinitionId == FindDefinitionId(Item.GetItemDefinitionHandle()), TEXT("Definition id is out of date for %s"), *Item.GetItemGuid().ToString());
+		checkf(ItemQuantities[i] == Item.Quantity, TEXT("Cached quantity is out of date for %s"), *Item.GetItemGuid().ToString());
+		StackCounts[DefinitionId]++;
+		Quantities[DefinitionId] += Item.Quantity;
+	}
+
+	for (int32 DefinitionId = 0; DefinitionId < ItemIndicesByDefinition.Num(); DefinitionId++)
+	{
+		checkf(ItemIndicesByDefinition[DefinitionId].Num() == StackCounts[DefinitionId], TEXT("Stack count is out of date for definition %d"), DefinitionId);
+		checkf(QuantityByDefinition[DefinitionId] == Quantities[DefinitionId], TEXT("Quantity total is out of date for definition %d"), DefinitionId);
+	}
+}
+
+void FFastCrimItemList::ValidateStackSignatures(const TInstancedStruct<FCrimItem>& TestItem) const
+{
+	const FCrimItem& Test = TestItem.Get<FCrimItem>();
+	if (!CrimItemSystem::IsItemIndexValidationEnabled() || !Test.UsesStackSignature())
+	{
+		return;
+	}
+
+	const uint64 Signature = Test.GetStackSignature();
+	for (int32 i = 0; i < Items.Num(); i++)
+	{
+		if (ItemSignatures[i] != Signature && Items[i].Item.Get<FCrimItem>().IsMatching(TestItem))
+		{
+			ensureMsgf(false, TEXT("Item %s (%s) matches the TestItem but has another stack signature. Override GetStackSignature along with IsMatching, or return false from UsesStackSignature."),
+				*ItemGuids[i].ToString(), *Items[i].Item.GetScriptStruct()->GetName());
+			return;
+		}
+	}
+}
+#endif
+
 //--------------------------------------------------------------------------
 // FastCrimItemContainer
 //--------------------------------------------------------------------------
@@ -114,11 +1130,27 @@ FString FFastCrimItemContainerItem::ToDebugString() const
 
 void FFastCrimItemContainerItem::PostReplicatedAdd(const FFastCrimItemContainerList& InItemContainerList)
 {
-	InItemContainerList.OnItemContainerAddedDelegate.Broadcast(*this);
+	// Null if the ItemContainer is not replicated to this connection. It is added once it resolves, if ever.
+	if (ItemContainer)
+	{
+		InItemContainerList.AddToLookup(ItemContainer);
+		InItemContainerList.OnItemContainerAddedDelegate.Broadcast(*this);
+	}
+}
+
+void FFastCrimItemContainerItem::PostReplicatedChange(const FFastCrimItemContainerList& InItemContainerList)
+{
+	// An ItemContainer that was not replicated to this connection when it was added, see ECrimItemContainerReplication.
+	if (ItemContainer && !InItemContainerList.Contains(ItemContainer))
+	{
+		InItemContainerList.AddToLookup(ItemContainer);
+		InItemContainerList.OnItemContainerAddedDelegate.Broadcast(*this);
+	}
 }
 
 void FFastCrimItemContainerItem::PreReplicatedRemove(const FFastCrimItemContainerList& InItemContainerList)
 {
+	InItemContainerList.RemoveFromLookup(ItemContainer);
 	InItemContainerList.OnItemContainerRemovedDelegate.Broadcast(*this);
 }
 
@@ -131,16 +1163,14 @@ void FFastCrimItemContainerList::AddItemContainer(UCrimItemContainerBase* ItemCo
 	if (IsValid(ItemContainer))
 	{
 		// Duplicate check.
-		for (const FFastCrimItemContainerItem& Entry : Items)
+		if (Contains(ItemContainer))
 		{
-			if (Entry.ItemContainer == ItemContainer)
-			{
-				return;
-			}
+			return;
 		}
 
 		FFastCrimItemContainerItem& NewEntry = Items.AddDefaulted_GetRef();
 		NewEntry.ItemContainer = ItemContainer;
+		AddToLookup(ItemContainer);
 		OnItemContainerAddedDelegate.Broadcast(NewEntry);
 		MarkItemDirty(NewEntry);
 	}
@@ -148,7 +1178,7 @@ void FFastCrimItemContainerList::AddItemContainer(UCrimItemContainerBase* ItemCo
 
 void FFastCrimItemContainerList::RemoveItemContainer(UCrimItemContainerBase* ItemContainer)
 {
-	if (IsValid(ItemContainer))
+	if (IsValid(ItemContainer) && Contains(ItemContainer))
 	{
 		for (auto EntryIt = Items.CreateIterator(); EntryIt; ++EntryIt)
 		{
@@ -157,6 +1187,7 @@ void FFastCrimItemContainerList::RemoveItemContainer(UCrimItemContainerBase* Ite
 			{
 				FFastCrimItemContainerItem TempEntry(Entry);
 				EntryIt.RemoveCurrentSwap();
+				RemoveFromLookup(ItemContainer);
 				OnItemContainerRemovedDelegate.Broadcast(TempEntry);
 				return;
 			}
@@ -169,3 +1200,67 @@ const TArray<FFastCrimItemContainerItem>& FFastCrimItemContainerList::GetItemCon
 	return Items;
 }
 
+UCrimItemContainerBase* FFastCrimItemContainerList::GetItemContainer(const FGameplayTag& ContainerGuid) const
+{
+	if (!ContainerGuid.IsValid())
+	{
+		return nullptr;
+	}
+
+	if (UCrimItemContainerBase* const* ItemContainer = ItemContainerMap.Find(ContainerGuid))
+	{
+		return *ItemContainer;
+	}
+
+	// Key any containers whose ContainerGuid has replicated since they were added.
+	if (ItemContainerMap.Num() < ItemContainerSet.Num())
+	{
+		for (const UCrimItemContainerBase* Entry : ItemContainerSet)
+		{
+			if (Entry->GetContainerGuid().IsValid())
+			{
+				ItemContainerMap.Add(Entry->GetContainerGuid(), const_cast<UCrimItemContainerBase*>(Entry));
+			}
+		}
+
+		if (UCrimItemContainerBase* const* ItemContainer = ItemContainerMap.Find(ContainerGuid))
+		{
+			return *ItemContainer;
+		}
+	}
+	return nullptr;
+}
+
+bool FFastCrimItemContainerList::Contains(const UCrimItemContainerBase* ItemContainer) const
+{
+	return ItemContainerSet.Contains(ItemContainer);
+}
+
+void FFastCrimItemContainerList::AddToLookup(UCrimItemContainerBase* ItemContainer) const
+{
+	if (ItemContainer == nullptr)
+	{
+		return;
+	}
+
+	ItemContainerSet.Add(ItemContainer);
+	if (ItemContainer->GetContainerGuid().IsValid())
+	{
+		ItemContainerMap.Add(ItemContainer->GetContainerGuid(), ItemContainer);
+	}
+}
+
+void FFastCrimItemContainerList::RemoveFromLookup(const UCrimItemContainerBase* ItemContainer) const
+{
+	if (ItemContainer == nullptr)
+	{
+		return;
+	}
+
+	ItemContainerSet.Remove(ItemContainer);
+	const FGameplayTag& ContainerGuid = ItemContainer->GetContainerGuid();
+	if (ItemContainerMap.FindRef(ContainerGuid) == ItemContainer)
+	{
+		ItemContainerMap.Remove(ContainerGuid);
+	}
+}
@@ -19,4 +19,5 @@ void FCrimItemGameplayTags::InitializeNativeGameplayTags()
 	GameplayTags.ItemPlan_Error_CantContainItem = UGameplayTagsManager::Get().AddNativeGameplayTag(FName("ItemPlan.Error.CantContainItem"), FString("The item is not allowed to be in the container."));
 	GameplayTags.ItemPlan_Error_QuantityIsZero = UGameplayTagsManager::Get().AddNativeGameplayTag(FName("ItemPlan.Error.QuantityIsZero"), FString("Tried to add less than 0 item quantity."));
 	GameplayTags.ItemPlan_Error_MaxStacksReached = UGameplayTagsManager::Get().AddNativeGameplayTag(FName("ItemPlan.Error.MaxStacksReached"), FString("The container has reached maximum amount of stacks for the item or the container."));
+	GameplayTags.ItemPlan_Error_StalePlan = UGameplayTagsManager::Get().AddNativeGameplayTag(FName("ItemPlan.Error.StalePlan"), FString("The ItemContainer was modified after the plan was built."));
 }
@@ -5,11 +5,13 @@
 
 #include "ItemContainer/CrimItemContainer.h"
 #include "CrimItemDefinition.h"
+#include "CrimItemGameplayTags.h"
 #include "CrimItemSet.h"
 #include "CrimItemSettings.h"
 #include "CrimItemSystem.h"
 #include "Engine/AssetManager.h"
 #include "Net/UnrealNetwork.h"
+#include "Net/Core/Misc/NetConditionGroupManager.h"
 #include "Serialization/ObjectAndNameAsStringProxyArchive.h"
 
 
@@ -66,17 +68,7 @@ void UCrimItemManagerComponent::GetLifetimeReplicatedProps(TArray<class FLifetim
 
 UCrimItemContainerBase* UCrimItemManagerComponent::GetItemContainerByGuid(FGameplayTag ContainerGuid) const
 {
-	if (ContainerGuid.IsValid())
-	{
-		for (const FFastCrimItemContainerItem& Entry : ItemContainerList.GetItemContainers())
-		{
-			if (Entry.GetItemContainer()->GetContainerGuid().MatchesTagExact(ContainerGuid))
-			{
-				return Entry.GetItemContainer();
-			}
-		}
-	}
-	return nullptr;
+	return ItemContainerList.GetItemContainer(ContainerGuid);
 }
 
 bool UCrimItemManagerComponent::HasItemContainer(const UCrimItemContainerBase* ItemContainer) const
@@ -86,15 +78,7 @@ bool UCrimItemManagerComponent::HasItemContainer(const UCrimItemContainerBase* I
 		return false;
 	}
 
-	for (const FFastCrimItemContainerItem& Entry : GetItemContainers())
-	{
-		if (Entry.GetItemContainer() == ItemContainer)
-		{
-			return true;
-		}
-	}
-
-	return false;
+	return ItemContainerList.Contains(ItemContainer);
 }
 
 const TArray<FFastCrimItemContainerItem>& UCrimItemManagerComponent::GetItemContainers() const
@@ -106,13 +90,10 @@ FFastCrimItem* UCrimItemManagerComponent::GetItemByGuid(FGuid ItemGuid) const
 {
 	if (ItemGuid.IsValid())
 	{
-		for (const FFastCrimItemContainerItem& Entry : GetItemContainers())
+		const FItemIndexEntry* Entry = ItemIndexByItemGuid.Find(ItemGuid);
+		if (UCrimItemContainerBase* ItemContainer = Entry ? Entry->ItemContainer.Get() : nullptr)
 		{
-			FFastCrimItem* Item = Entry.GetItemContainer()->GetItemByGuid(ItemGuid);
-			if (Item != nullptr)
-			{
-				return Item;
-			}
+			return ItemContainer->GetItemByGuid(ItemGuid);
 		}
 	}
 	return nullptr;
@@ -120,45 +101,66 @@ FFastCrimItem* UCrimItemManagerComponent::GetItemByGuid(FGuid ItemGuid) const
 
 TInstancedStruct<FCrimItem> UCrimItemManagerComponent::K2_GetItemByGuid(FGuid ItemGuid) const
 {
-	if (ItemGuid.IsValid())
+	if (FFastCrimItem* FastItem = GetItemByGuid(ItemGuid))
 	{
-		for (const FFastCrimItemContainerItem& Entry : GetItemContainers())
+		return FastItem->Item;
+	}
+	return TInstancedStruct<FCrimItem>();
+}
+
+void UCrimItemManagerComponent::ForEachItemByDefinition(const UCrimItemDefinition* ItemDefinition, TFunctionRef<bool(UCrimItemContainerBase*, FFastCrimItem&)> Func) const
+{
+	if (ItemDefinition)
+	{
+		if (const TArray<FCrimItemLocation>* Locations = ItemLocationsByDefinition.Find(ItemDefinition->GetItemDefinitionHandle()))
 		{
-			TInstancedStruct<FCrimItem> Item = Entry.GetItemContainer()->K2_GetItemByGuid(ItemGuid);
-			if (Item.IsValid())
+			for (const FCrimItemLocation& Location : *Locations)
 			{
-				return Item;
+				UCrimItemContainerBase* ItemContainer = Location.ItemContainer.Get();
+				FFastCrimItem* FastItem = ItemContainer ? ItemContainer->GetItemByGuid(Location.ItemGuid) : nullptr;
+				if (FastItem && !Func(ItemContainer, *FastItem))
+				{
+					return;
+				}
 			}
 		}
 	}
-	return TInstancedStruct<FCrimItem>();
 }
 
 TArray<FFastCrimItem*> UCrimItemManagerComponent::GetItemsByDefinition(const UCrimItemDefinition* ItemDefinition) const
 {
 	TArray<FFastCrimItem*> Result;
-
-	if (ItemDefinition)
+	ForEachItemByDefinition(ItemDefinition, [&Result](UCrimItemContainerBase* ItemContainer, FFastCrimItem& FastItem)
 	{
-		for (const FFastCrimItemContainerItem& Entry : GetItemContainers())
-		{
-			Result.Append(Entry.GetItemContainer()->GetItemsByDefinition(ItemDefinition));
-		}
-	}
+		Result.Add(&FastItem);
+		return true;
+	});
 	return Result;
-	
 }
+int32 UCrimItemManagerComponent::GetItemStackCountByDefinition(FCrimItemDefinitionHandle ItemDefinition) const
+{
+	const TArray<FCrimItemLocation>* Locations = ItemLocationsByDefinition.Find(ItemDefinition);
+	return Locations ? Locations->Num() : 0;
+}
+
+uint32 UCrimItemManagerComponent::GetItemIndexVersion() const
+{
+	return ItemIndexVersion;
+}
+
+int32 UCrimItemManagerComponent::GetItemQuantityByDefinition(FCrimItemDefinitionHandle ItemDefinition) const
+{
+	return ItemQuantityByDefinition.FindRef(ItemDefinition);
+}
+
 TArray<TInstancedStruct<FCrimItem>> UCrimItemManagerComponent::K2_GetItemsByDefinition(const UCrimItemDefinition* ItemDefinition) const
 {
 	TArray<TInstancedStruct<FCrimItem>> Result;
-
-	if (ItemDefinition)
+	ForEachItemByDefinition(ItemDefinition, [&Result](UCrimItemContainerBase* ItemContainer, const FFastCrimItem& FastItem)
 	{
-		for (const FFastCrimItemContainerItem& Entry : GetItemContainers())
-		{
-			Result.Append(Entry.GetItemContainer()->K2_GetItemsByDefinition(ItemDefinition));
-		}
-	}
+		Result.Add(FastItem.Item);
+		return true;
+	});
 	return Result;
 }
 
@@ -169,28 +171,77 @@ void UCrimItemManagerComponent::ConsumeItemsByDefinition(const UCrimItemDefiniti
 		return;
 	}
 
-	int32 QuantityRemaining = Quantity;
-	for (FFastCrimItem*& FastItem : GetItemsByDefinition(ItemDefinition))
+	FCrimItemBatchScope BatchScope(this);
+	Internal_ConsumeItemsByDefinition(ItemDefinition, Quantity);
+}
+
+FCrimConsumeRecipeResult UCrimItemManagerComponent::ConsumeRecipe(const TArray<FCrimItemRecipeIngredient>& Ingredients)
+{
+	FCrimConsumeRecipeResult Result;
+	if (!HasAuthority())
 	{
-		FCrimItem* Item = FastItem->Item.GetMutablePtr<FCrimItem>();
-		const int32 NewQuantity = FMath::Max(Item->Quantity - QuantityRemaining, 0);
-		QuantityRemaining = FMath::Max(QuantityRemaining - Item->Quantity, 0);
-		Item->Quantity = NewQuantity;
+		return Result;
+	}
 
-		if (NewQuantity <= 0)
+	// Combine ingredients sharing an ItemDefinition so their availability is checked against the total.
+	TArray<FCrimItemRecipeIngredient, TInlineAllocator<8>> RequiredIngredients;
+	for (const FCrimItemRecipeIngredient& Ingredient : Ingredients)
+	{
+		if (!Ingredient.ItemDefinition || Ingredient.Quantity <= 0)
+		{
+			continue;
+		}
+
+		FCrimItemRecipeIngredient* Existing = RequiredIngredients.FindByPredicate([&Ingredient](const FCrimItemRecipeIngredient& Entry)
+		{
+			return Entry.ItemDefinition == Ingredient.ItemDefinition;
+		});
+		if (Existing)
 		{
-			Item->GetItemContainer()->Internal_RemoveItem(Item->GetItemGuid());
+			Existing->Quantity += Ingredient.Quantity;
 		}
 		else
 		{
-			Item->GetItemContainer()->MarkItemDirty(*FastItem);	
+			RequiredIngredients.Add(Ingredient);
 		}
+	}
 
-		if (QuantityRemaining == 0)
+	for (const FCrimItemRecipeIngredient& Ingredient : RequiredIngredients)
+	{
+		const int32 Available = GetItemQuantityByDefinition(Ingredient.ItemDefinition->GetItemDefinitionHandle());
+		if (Available < Ingredient.Quantity)
 		{
-			return;
+			Result.MissingIngredients.Add(FCrimItemRecipeIngredient(Ingredient.ItemDefinition, Ingredient.Quantity - Available));
 		}
 	}
+	if (Result.MissingIngredients.Num() > 0)
+	{
+		return Result;
+	}
+
+	// Every ItemContainer replicates and broadcasts its changes once, after all ingredients are consumed.
+	FCrimItemBatchScope BatchScope(this);
+	for (const FCrimItemRecipeIngredient& Ingredient : RequiredIngredients)
+	{
+		Internal_ConsumeItemsByDefinition(Ingredient.ItemDefinition, Ingredient.Quantity, &Result.ConsumedItems);
+	}
+
+	Result.bSuccess = true;
+	return Result;
+}
+
+FCrimAddItemResult UCrimItemManagerComponent::MoveItem(const FGuid ItemGuid, UCrimItemContainerBase* TargetContainer, int32 Quantity)
+{
+	const FItemIndexEntry* Entry = ItemIndexByItemGuid.Find(ItemGuid);
+	UCrimItemContainerBase* SourceContainer = Entry ? Entry->ItemContainer.Get() : nullptr;
+	if (!HasAuthority() || !IsValid(SourceContainer))
+	{
+		FCrimAddItemResult Result;
+		Result.Error = FCrimItemGameplayTags::Get().ItemPlan_Error_ItemContainerNotFound;
+		return Result;
+	}
+
+	return SourceContainer->MoveItem(ItemGuid, TargetContainer, Quantity);
 }
 
 UCrimItemContainerBase* UCrimItemManagerComponent::CreateItemContainer(FGameplayTag ContainerGuid,
@@ -203,12 +254,7 @@ UCrimItemContainerBase* UCrimItemManagerComponent::CreateItemContainer(FGameplay
 
 	if (ContainerGuid.IsValid())
 	{
-		const FFastCrimItemContainerItem* ExistingContainer = ItemContainerList.GetItemContainers().FindByPredicate(
-		   [ContainerGuid](const FFastCrimItemContainerItem& Entry)
-		   {
-			   return Entry.GetItemContainer()->GetContainerGuid().MatchesTagExact(ContainerGuid);
-		   });
-		if (ExistingContainer)
+		if (GetItemContainerByGuid(ContainerGuid))
 		{
 			UE_LOG(LogCrimItemSystem, Verbose,
 				   TEXT("CreateItemContainer already has %s as a ContainerId. Skip creating the container."),
@@ -219,7 +265,11 @@ UCrimItemContainerBase* UCrimItemManagerComponent::CreateItemContainer(FGameplay
 
 	UCrimItemContainerBase* NewContainer = NewObject<UCrimItemContainerBase>(this, ItemContainerClass);
 	NewContainer->Initialize(this, ContainerGuid);
-	AddReplicatedSubObject(NewContainer);
+	if (NewContainer->GetReplicationPolicy() == ECrimItemContainerReplication::NetConditionGroup)
+	{
+		UE::Net::FNetConditionGroupManager::RegisterSubObjectInGroup(NewContainer, NewContainer->GetNetConditionGroup());
+	}
+	AddReplicatedSubObject(NewContainer, NewContainer->GetReplicationCondition());
 	ItemContainerList.AddItemContainer(NewContainer);
 	return NewContainer;
 }
@@ -231,10 +281,18 @@ void UCrimItemManagerComponent::RemoveItemContainer(UCrimItemContainerBase* Item
 		return;
 	}
 	
-	ItemContainer->ItemList.Reset();
+	{
+		// The ItemList is emptied before the removals are broadcast, batching holds off validating the half updated index.
+		FCrimItemBatchScope BatchScope(ItemContainer);
+		ItemContainer->ItemList.Reset();
+	}
 
 	ItemContainerList.RemoveItemContainer(ItemContainer);
 	RemoveReplicatedSubObject(ItemContainer);
+	if (ItemContainer->GetReplicationPolicy() == ECrimItemContainerReplication::NetConditionGroup)
+	{
+		UE::Net::FNetConditionGroupManager::UnregisterSubObjectFromAllGroups(ItemContainer);
+	}
 	ItemContainer->MarkAsGarbage();
 }
 
@@ -300,7 +358,8 @@ void UCrimItemManagerComponent::LoadSavedData(const FCrimItemManagerSaveData& Sa
 			FObjectAndNameAsStringProxyArchive Archive(MemoryReader, true);
 			Archive.ArIsSaveGame = true;
 			NewContainer->Serialize(Archive);
-			
+
+			NewContainer->ItemList.Reserve(ContainerData.Items.Num());
 			for (const FCrimItemSaveData& ItemData : ContainerData.Items)
 			{
 				// Do not restore the item's data if the ItemDef is invalid.
@@ -326,7 +385,7 @@ void UCrimItemManagerComponent::LoadSavedData(const FCrimItemManagerSaveData& Sa
 				NewItem.Serialize(Ar);
 				if (NewItem.IsValid())
 				{
-					NewContainer->Internal_AddItem(NewItem);
+					NewContainer->Internal_AddItem(MoveTemp(NewItem));
 				}
 			}
 		}
@@ -338,15 +397,95 @@ bool UCrimItemManagerComponent::HasAuthority() const
 	return !bCachedIsNetSimulated;
 }
 
+void UCrimItemManagerComponent::ServerSplitItemStack_Implementation(UCrimItemContainer* ItemContainer, FGuid ItemGuid,
+	int32 Quantity, FGuid NewItemGuid, int32 PredictionKey)
+{
+	const bool bAccepted = CanAcceptPrediction(ItemContainer) &&
+		ItemContainer->Internal_SplitItemStack(ItemGuid, Quantity, NewItemGuid);
+	SendPredictionResult(ItemContainer, PredictionKey, bAccepted, {ItemGuid});
+}
+
+void UCrimItemManagerComponent::ServerStackItems_Implementation(UCrimItemContainer* ItemContainer, FGuid SourceItemGuid,
+	FGuid TargetItemGuid, int32 Quantity, int32 PredictionKey)
+{
+	const bool bAccepted = CanAcceptPrediction(ItemContainer) &&
+		ItemContainer->Internal_StackItems(SourceItemGuid, TargetItemGuid, Quantity);
+	SendPredictionResult(ItemContainer, PredictionKey, bAccepted, {SourceItemGuid, TargetItemGuid});
+}
+
+void UCrimItemManagerComponent::ServerConsumeItem_Implementation(UCrimItemContainerBase* ItemContainer, FGuid ItemGuid,
+	int32 Quantity, bool bRemoveItem, int32 PredictionKey)
+{
+	const bool bAccepted = CanAcceptPrediction(ItemContainer) &&
+		ItemContainer->Internal_ConsumeItem(ItemGuid, Quantity, bRemoveItem) > 0;
+	SendPredictionResult(ItemContainer, PredictionKey, bAccepted, {ItemGuid});
+}
+
+void UCrimItemManagerComponent::ClientPredictionResult_Implementation(UCrimItemContainerBase* ItemContainer,
+	int32 PredictionKey, bool bAccepted)
+{
+	if (IsValid(ItemContainer) && ItemContainer->GetItemManagerComponent() == this)
+	{
+		ItemContainer->OnPredictionResult(PredictionKey, bAccepted);
+	}
+}
+
+bool UCrimItemManagerComponent::CanAcceptPrediction(const UCrimItemContainerBase* ItemContainer) const
+{
+	return HasAuthority() && IsValid(ItemContainer) && ItemContainer->GetItemManagerComponent() == this &&
+		ItemContainer->IsClientPredictionAllowed();
+}
+
+void UCrimItemManagerComponent::SendPredictionResult(UCrimItemContainerBase* ItemContainer, int32 PredictionKey,
+	bool bAccepted, TConstArrayView<FGuid> ItemGuids)
+{
+	if (!bAccepted && CanAcceptPrediction(ItemContainer))
+	{
+		// Resends the whole items over the client's rolled back copies. Nothing changed here, so nothing is broadcast.
+		for (const FGuid& ItemGuid : ItemGuids)
+		{
+			if (FFastCrimItem* FastItem = ItemContainer->GetItemByGuid(ItemGuid))
+			{
+				ItemContainer->ItemList.MarkItemSectionsDirty(*FastItem, ECrimItemNetSection::All);
+			}
+		}
+	}
+	ClientPredictionResult(ItemContainer, PredictionKey, bAccepted);
+}
+
 void UCrimItemManagerComponent::OnItemContainerAdded(const FFastCrimItemContainerItem& Entry)
 {
-	OnItemContainerAddedDelegate.Broadcast(this, Entry.GetItemContainer());
-	BindToItemContainerDelegates(Entry.GetItemContainer());
+	UCrimItemContainerBase* ItemContainer = Entry.GetItemContainer();
+
+	// On clients the ItemContainer may have received its items before it was added to the list.
+	for (const FFastCrimItem& FastItem : ItemContainer->GetItems())
+	{
+		AddToItemIndex(ItemContainer, FastItem);
+	}
+
+	OnItemContainerAddedDelegate.Broadcast(this, ItemContainer);
+	BindToItemContainerDelegates(ItemContainer);
 }
 
 void UCrimItemManagerComponent::OnItemContainerRemoved(const FFastCrimItemContainerItem& Entry)
 {
-	OnItemContainerRemovedDelegate.Broadcast(this, Entry.GetItemContainer());
+	UCrimItemContainerBase* ItemContainer = Entry.GetItemContainer();
+	if (IsValid(ItemContainer))
+	{
+		// Includes the items this client predicted, which are indexed like the replicated ones.
+		ItemContainer->ForEachItem([this, ItemContainer](const FFastCrimItem& FastItem)
+		{
+			RemoveFromItemIndex(ItemContainer, FastItem);
+			return true;
+		});
+	}
+	else
+	{
+		// The ItemContainer was destroyed before its items were removed.
+		RemoveStaleItemIndexEntries();
+	}
+
+	OnItemContainerRemovedDelegate.Broadcast(this, ItemContainer);
 }
 
 void UCrimItemManagerComponent::OnItemAdded(UCrimItemContainerBase* ItemContainer, const FFastCrimItem& Item)
@@ -364,6 +503,11 @@ void UCrimItemManagerComponent::OnItemChanged(UCrimItemContainerBase* ItemContai
 	OnItemChangedDelegate.Broadcast(this, ItemContainer, Item);
 }
 
+void UCrimItemManagerComponent::OnItemMoved(UCrimItemContainerBase* SourceContainer, UCrimItemContainerBase* TargetContainer, const FFastCrimItem& Item)
+{
+	OnItemMovedDelegate.Broadcast(this, SourceContainer, TargetContainer, Item);
+}
+
 void UCrimItemManagerComponent::CacheIsNetSimulated()
 {
 	bCachedIsNetSimulated = IsNetSimulating();
@@ -380,16 +524,18 @@ void UCrimItemManagerComponent::InitializeStartupItems()
 	{
 		if (UCrimItemContainerBase* ItemContainer = CreateItemContainer(Startup.Key, Startup.Value.ItemContainerClass))
 		{
+			TArray<TInstancedStruct<FCrimItem>> Items;
 			for (const UCrimItemSet* ItemSet : Startup.Value.ItemSets)
 			{
 				if (ItemSet)
 				{
 					for (const FCrimItemInstance& ItemInstance : ItemSet->ItemInstances)
 					{
-						ItemContainer->TryAddItem(ItemInstance.GetItem());	
+						Items.Add(ItemInstance.GetItem());
 					}
 				}
 			}
+			ItemContainer->TryAddItems(Items);
 		}
 	}
 }
@@ -402,7 +548,269 @@ void UCrimItemManagerComponent::BindToItemContainerListDelegates()
 
 void UCrimItemManagerComponent::BindToItemContainerDelegates(UCrimItemContainerBase* Container)
 {
-	Container->OnItemAddedDelegate.AddUObject(this, &UCrimItemManagerComponent::OnItemAdded);
-	Container->OnItemRemovedDelegate.AddUObject(this, &UCrimItemManagerComponent::OnItemRemoved);
-	Container->OnItemChangedDelegate.AddUObject(this, &UCrimItemManagerComponent::OnItemChanged);
+	Container->OnItemAddedDelegate.AddUObject(this, &UCrimItemManagerComponent::Internal_OnItemAdded);
+	Container->OnItemRemovedDelegate.AddUObject(this, &UCrimItemManagerComponent::Internal_OnItemRemoved);
+	Container->OnItemChangedDelegate.AddUObject(this, &UCrimItemManagerComponent::Internal_OnItemChanged);
+}
+
+void UCrimItemManagerComponent::Internal_OnItemAdded(UCrimItemContainerBase* ItemContainer, const FFastCrimItem& Item)
+{
+	UCrimItemContainerBase* MovedFrom = AddToItemIndex(ItemContainer, Item);
+#if DO_CHECK && !UE_BUILD_SHIPPING
+	ValidateItemIndex();
+#endif
+	UCrimItemContainerBase* SourceContainer = MovingItemSource.Get();
+	if (MovedFrom == nullptr && SourceContainer && SourceContainer != ItemContainer &&
+		Item.Item.Get<FCrimItem>().GetItemGuid() == MovingItemGuid)
+	{
+		// The item was removed from the SourceContainer first.
+		MovedFrom = SourceContainer;
+	}
+	if (MovedFrom)
+	{
+		OnItemMoved(MovedFrom, ItemContainer, Item);
+		return;
+	}
+	OnItemAdded(ItemContainer, Item);
+}
+
+void UCrimItemManagerComponent::Internal_OnItemRemoved(UCrimItemContainerBase* ItemContainer, const FFastCrimItem& Item)
+{
+	const FGuid ItemGuid = Item.Item.Get<FCrimItem>().GetItemGuid();
+	const FItemIndexEntry* Entry = ItemIndexByItemGuid.Find(ItemGuid);
+	if (Entry && Entry->ItemContainer.IsValid() && Entry->ItemContainer.Get() != ItemContainer)
+	{
+		// The item was added to another ItemContainer first, which already broadcast the move.
+		return;
+	}
+
+	RemoveFromItemIndex(ItemContainer, Item);
+#if DO_CHECK && !UE_BUILD_SHIPPING
+	ValidateItemIndex();
+#endif
+	if (MovingItemSource.Get() == ItemContainer && ItemGuid == MovingItemGuid)
+	{
+		// Broadcast as a move once the item is added to the TargetContainer.
+		return;
+	}
+	OnItemRemoved(ItemContainer, Item);
+}
+
+void UCrimItemManagerComponent::Internal_OnItemChanged(UCrimItemContainerBase* ItemContainer, const FFastCrimItem& Item)
+{
+	UpdateItemIndex(ItemContainer, Item);
+#if DO_CHECK && !UE_BUILD_SHIPPING
+	ValidateItemIndex();
+#endif
+	OnItemChanged(ItemContainer, Item);
+}
+
+UCrimItemContainerBase* UCrimItemManagerComponent::AddToItemIndex(UCrimItemContainerBase* ItemContainer, const FFastCrimItem& Item)
+{
+	const FCrimItem* ItemPtr = Item.Item.GetPtr<FCrimItem>();
+	if (ItemPtr == nullptr)
+	{
+		return nullptr;
+	}
+
+	const FGuid ItemGuid = ItemPtr->GetItemGuid();
+	if (const FItemIndexEntry* Entry = ItemIndexByItemGuid.Find(ItemGuid))
+	{
+		UCrimItemContainerBase* PreviousContainer = Entry->ItemContainer.Get();
+		if (PreviousContainer == ItemContainer)
+		{
+			return nullptr;
+		}
+
+		// The removal from the PreviousContainer arrives later and is ignored, as the item no longer points at it.
+		RemoveItemIndexEntry(ItemGuid);
+		AddToItemIndex(ItemContainer, Item);
+		return PreviousContainer;
+	}
+
+	++ItemIndexVersion;
+	const FCrimItemDefinitionHandle ItemDefinition = ItemPtr->GetItemDefinitionHandle();
+	TArray<FCrimItemLocation>& Locations = ItemLocationsByDefinition.FindOrAdd(ItemDefinition);
+
+	FItemIndexEntry& NewEntry = ItemIndexByItemGuid.Add(ItemGuid);
+	NewEntry.ItemContainer = ItemContainer;
+	NewEntry.ItemDefinition = ItemDefinition;
+	NewEntry.LocationIndex = Locations.Add(FCrimItemLocation(ItemContainer, ItemGuid, ItemPtr->Quantity));
+	ItemQuantityByDefinition.FindOrAdd(ItemDefinition) += ItemPtr->Quantity;
+	return nullptr;
+}
+
+void UCrimItemManagerComponent::RemoveFromItemIndex(UCrimItemContainerBase* ItemContainer, const FFastCrimItem& Item)
+{
+	const FCrimItem* ItemPtr = Item.Item.GetPtr<FCrimItem>();
+	if (ItemPtr == nullptr)
+	{
+		return;
+	}
+
+	const FGuid ItemGuid = ItemPtr->GetItemGuid();
+	const FItemIndexEntry* Entry = ItemIndexByItemGuid.Find(ItemGuid);
+	if (Entry == nullptr || Entry->ItemContainer.Get() != ItemContainer)
+	{
+		return;
+	}
+	RemoveItemIndexEntry(ItemGuid);
+}
+
+void UCrimItemManagerComponent::UpdateItemIndex(UCrimItemContainerBase* ItemContainer, const FFastCrimItem& Item)
+{
+	const FCrimItem* ItemPtr = Item.Item.GetPtr<FCrimItem>();
+	if (ItemPtr == nullptr)
+	{
+		return;
+	}
+
+	const FItemIndexEntry* Entry = ItemIndexByItemGuid.Find(ItemPtr->GetItemGuid());
+	if (Entry == nullptr || Entry->ItemContainer.Get() != ItemContainer)
+	{
+		return;
+	}
+
+	FCrimItemLocation& Location = ItemLocationsByDefinition.FindChecked(Entry->ItemDefinition)[Entry->LocationIndex];
+	if (Location.Quantity != ItemPtr->Quantity)
+	{
+		ItemQuantityByDefinition.FindChecked(Entry->ItemDefinition) += ItemPtr->Quantity - Location.Quantity;
+		Location.Quantity = ItemPtr->Quantity;
+		++ItemIndexVersion;
+	}
+}
+
+void UCrimItemManagerComponent::RemoveItemIndexEntry(const FGuid& ItemGuid)
+{
+	FItemIndexEntry Entry;
+	if (!ItemIndexByItemGuid.RemoveAndCopyValue(ItemGuid, Entry))
+	{
+		return;
+	}
+	++ItemIndexVersion;
+
+	TArray<FCrimItemLocation>& Locations = ItemLocationsByDefinition.FindChecked(Entry.ItemDefinition);
+	// The item's current quantity may have changed without a change notification, remove the indexed one.
+	ItemQuantityByDefinition.FindChecked(Entry.ItemDefinition) -= Locations[Entry.LocationIndex].Quantity;
+	Locations.RemoveAtSwap(Entry.LocationIndex, 1, EAllowShrinking::No);
+	if (Locations.IsValidIndex(Entry.LocationIndex))
+	{
+		// The last location was swapped into the removed one.
+		ItemIndexByItemGuid.FindChecked(Locations[Entry.LocationIndex].ItemGuid).LocationIndex = Entry.LocationIndex;
+	}
+	else if (Locations.Num() == 0)
+	{
+		ItemLocationsByDefinition.Remove(Entry.ItemDefinition);
+		ItemQuantityByDefinition.Remove(Entry.ItemDefinition);
+	}
+}
+
+void UCrimItemManagerComponent::RemoveStaleItemIndexEntries()
+{
+	TArray<FGuid> StaleItemGuids;
+	for (const TTuple<FGuid, FItemIndexEntry>& Pair : ItemIndexByItemGuid)
+	{
+		if (!Pair.Value.ItemContainer.IsValid())
+		{
+			StaleItemGuids.Add(Pair.Key);
+		}
+	}
+	for (const FGuid& ItemGuid : StaleItemGuids)
+	{
+		RemoveItemIndexEntry(ItemGuid);
+	}
+}
+
+int32 UCrimItemManagerComponent::Internal_ConsumeItemsByDefinition(const UCrimItemDefinition* ItemDefinition, int32 Quantity,
+	TArray<FCrimConsumedItem>* OutConsumedItems)
+{
+	int32 QuantityRemaining = Quantity;
+	ForEachItemByDefinition(ItemDefinition, [&QuantityRemaining, OutConsumedItems](UCrimItemContainerBase* ItemContainer, FFastCrimItem& FastItem)
+	{
+		FCrimItem* Item = FastItem.Item.GetMutablePtr<FCrimItem>();
+		const int32 NewQuantity = FMath::Max(Item->Quantity - QuantityRemaining, 0);
+		const int32 Delta = Item->Quantity - NewQuantity;
+		QuantityRemaining = QuantityRemaining - Delta;
+		Item->Quantity = NewQuantity;
+		// The removal is deferred by the batch, keep the ItemContainer's totals current in the meantime.
+		ItemContainer->ItemList.RefreshItemIndex(FastItem);
+
+		if (OutConsumedItems && Delta > 0)
+		{
+			FCrimConsumedItem& ConsumedItem = OutConsumedItems->AddDefaulted_GetRef();
+			ConsumedItem.ItemContainer = ItemContainer;
+			ConsumedItem.ItemGuid = Item->GetItemGuid();
+			ConsumedItem.ItemDefinition = Item->GetItemDefinition();
+			ConsumedItem.Quantity = Delta;
+			ConsumedItem.bRemoved = NewQuantity <= 0;
+		}
+
+		if (NewQuantity <= 0)
+		{
+			ItemContainer->Internal_RemoveItem(Item->GetItemGuid());
+		}
+		else
+		{
+			ItemContainer->MarkItemDirty(FastItem, ECrimItemNetSection::Quantity);
+		}
+		return QuantityRemaining > 0;
+	});
+	return Quantity - QuantityRemaining;
+}
+
+#if DO_CHECK && !UE_BUILD_SHIPPING
+void UCrimItemManagerComponent::ValidateItemIndex() const
+{
+	// Clients index a replicated update one notification at a time after all of it was applied, and batches hold their
+	// notifications back. The index only matches the items on the server outside of batches.
+	if (!CrimItemSystem::IsItemIndexValidationEnabled() || !HasAuthority())
+	{
+		return;
+	}
+	for (const FFastCrimItemContainerItem& Entry : GetItemContainers())
+	{
+		const UCrimItemContainerBase* ItemContainer = Entry.GetItemContainer();
+		if (IsValid(ItemContainer) && ItemContainer->IsBatching())
+		{
+			return;
+		}
+	}
+
+	int32 NumItems = 0;
+	TMap<FCrimItemDefinitionHandle, int32> Quantities;
+	for (const FFastCrimItemContainerItem& Entry : GetItemContainers())
+	{
+		const UCrimItemContainerBase* ItemContainer = Entry.GetItemContainer();
+		if (!IsValid(ItemContainer))
+		{
+			continue;
+		}
+		ItemContainer->ForEachItem([this, ItemContainer, &NumItems, &Quantities](const FFastCrimItem& FastItem)
+		{
+			const FCrimItem& Item = FastItem.Item.Get<FCrimItem>();
+			const FItemIndexEntry* IndexEntry = ItemIndexByItemGuid.Find(Item.GetItemGuid());
+			checkf(IndexEntry && IndexEntry->ItemContainer.Get() == ItemContainer, TEXT("Item %s is indexed in the wrong ItemContainer"), *Item.GetItemGuid().ToString());
+			Quantities.FindOrAdd(Item.GetItemDefinitionHandle()) += Item.Quantity;
+			NumItems++;
+			return true;
+		});
+	}
+	check(ItemIndexByItemGuid.Num() == NumItems);
+
+	int32 NumLocations = 0;
+	for (const TTuple<FCrimItemDefinitionHandle, TArray<FCrimItemLocation>>& Pair : ItemLocationsByDefinition)
+	{
+		for (int32 LocationIndex = 0; LocationIndex < Pair.Value.Num(); LocationIndex++)
+		{
+			const FCrimItemLocation& Location = Pair.Value[LocationIndex];
+			const FItemIndexEntry* Entry = ItemIndexByItemGuid.Find(Location.ItemGuid);
+			checkf(Entry && Entry->ItemContainer == Location.ItemContainer && Entry->LocationIndex == LocationIndex,
+				TEXT("Item %s is indexed in the wrong location"), *Location.ItemGuid.ToString());
+		}
+		NumLocations += Pair.Value.Num();
+		checkf(ItemQuantityByDefinition.FindRef(Pair.Key) == Quantities.FindRef(Pair.Key), TEXT("Quantity total is out of date for definition %d"), Pair.Key.GetIndex());
+	}
+	check(NumLocations == NumItems);
+	check(ItemQuantityByDefinition.Num() == ItemLocationsByDefinition.Num());
 }
+#endif
@@ -41,13 +41,9 @@ TInstancedStruct<FCrimItemFragment> UCrimItemStatics::K2_GetItemFragment(const T
 {
 	if (Item.IsValid() && FragmentType)
 	{
-		const FCrimItem* ItemPtr = Item.GetPtr<FCrimItem>();
-		for (const TInstancedStruct<FCrimItemFragment>& Fragment : ItemPtr->Fragments)
+		if (const TInstancedStruct<FCrimItemFragment>* Fragment = Item.Get<FCrimItem>().FindFragment(FragmentType))
 		{
-			if (Fragment.IsValid() && Fragment.GetScriptStruct()->IsChildOf(FragmentType))
-			{
-				return Fragment;
-			}
+			return *Fragment;
 		}
 	}
 	return TInstancedStruct<FCrimItemFragment>();
@@ -57,12 +53,9 @@ TInstancedStruct<FCrimItemDefinitionFragment> UCrimItemStatics::K2_GetItemDefini
 {
 	if (ItemDefinition && FragmentType)
 	{
-		for (const TInstancedStruct<FCrimItemDefinitionFragment>& Fragment : ItemDefinition->Fragments)
+		if (const TInstancedStruct<FCrimItemDefinitionFragment>* Fragment = ItemDefinition->FindFragment(FragmentType))
 		{
-			if (Fragment.IsValid() && Fragment.GetScriptStruct()->IsChildOf(FragmentType))
-			{
-				return Fragment;
-			}
+			return *Fragment;
 		}
 	}
 	return TInstancedStruct<FCrimItemDefinitionFragment>();
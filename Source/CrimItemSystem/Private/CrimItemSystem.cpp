@@ -3,11 +3,29 @@
 #include "CrimItemSystem.h"
 
 #include "CrimItemGameplayTags.h"
+#include "HAL/IConsoleManager.h"
 
 #define LOCTEXT_NAMESPACE "FCrimItemSystemModule"
 
 DEFINE_LOG_CATEGORY(LogCrimItemSystem);
 
+#if DO_CHECK && !UE_BUILD_SHIPPING
+namespace CrimItemSystem
+{
+	static bool bValidateItemIndex = false;
+	static FAutoConsoleVariableRef CVarValidateItemIndex(
+		TEXT("CrimItemSystem.ValidateItemIndex"),
+		bValidateItemIndex,
+		TEXT("If true, the lookup indices of the ItemLists and ItemManagers are recounted and checked after every change. ")
+		TEXT("This walks every item on each change, so only enable it to track down an index that is out of date."));
+
+	bool IsItemIndexValidationEnabled()
+	{
+		return bValidateItemIndex;
+	}
+}
+#endif
+
 void FCrimItemSystemModule::StartupModule()
 {
 	// This code will execute after your module is loaded into memory; the exact timing is specified in the .uplugin file per-module
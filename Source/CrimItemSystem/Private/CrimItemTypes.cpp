@@ -4,6 +4,9 @@
 #include "CrimItemTypes.h"
 
 #include "CrimItemFastTypes.h"
+#include "Algo/BinarySearch.h"
+#include "Algo/IsSorted.h"
+#include "Algo/Sort.h"
 
 
 int32 FCrimItemQuantityLimit::GetMaxQuantity() const
@@ -63,6 +66,21 @@ const TArray<FCrimAddItemPlanEntry>& FCrimAddItemPlan::GetEntries() const
 	return Entries;
 }
 
+UCrimItemContainerBase* FCrimAddItemPlan::GetItemContainer() const
+{
+	return ItemContainer.Get();
+}
+
+uint32 FCrimAddItemPlan::GetItemContainerVersion() const
+{
+	return ItemContainerVersion;
+}
+
+uint32 FCrimAddItemPlan::GetItemManagerVersion() const
+{
+	return ItemManagerVersion;
+}
+
 void FCrimAddItemPlan::UpdateAmountGiven(int32 NewValue)
 {
 	AmountGiven = AmountGiven + NewValue;
@@ -81,6 +99,11 @@ void FCrimAddItemPlan::UpdateAmountGiven(int32 NewValue)
 	}
 }
 
+bool FCrimItemContainerChangeset::IsEmpty() const
+{
+	return AddedItems.Num() == 0 && ChangedItems.Num() == 0 && RemovedItems.Num() == 0;
+}
+
 FCrimAddItemResult::FCrimAddItemResult(const FCrimAddItemPlan& InPlan, const TArray<TInstancedStruct<FCrimItem>>& InItems)
 {
 	AmountToGive = InPlan.AmountToGive;
@@ -126,26 +149,27 @@ void FCrimItemTagStackContainer::AddStack(FGameplayTag Tag, int32 DeltaCount)
 		return;
 	}
 
-	for (auto It = Items.CreateIterator(); It; ++It)
+	const int32 Index = LowerBound(Tag);
+	if (Items.IsValidIndex(Index) && Items[Index].Tag == Tag)
 	{
-		FCrimItemTagStack& Stack = *It;
-		
-		if (Stack.Tag == Tag)
+		if (Items[Index].Count + DeltaCount == 0)
 		{
-			if (Stack.Count + DeltaCount == 0)
-			{
-				// remove the tag entirely since the value is 0.
-				It.RemoveCurrent();
-			}
-			else
-			{
-				Stack.Count += DeltaCount;
-			}
-			return;
+			// remove the tag entirely since the value is 0.
+			Items.RemoveAt(Index);
+			bTagCacheDirty = true;
 		}
+		else
+		{
+			Items[Index].Count += DeltaCount;
+		}
+		return;
 	}
 
-	Items.Add(FCrimItemTagStack(Tag, DeltaCount));
+	Items.Insert(FCrimItemTagStack(Tag, DeltaCount), Index);
+	if (!bTagCacheDirty)
+	{
+		TagCache.AddTag(Tag);
+	}
 }
 
 void FCrimItemTagStackContainer::SubtractStack(FGameplayTag Tag, int32 DeltaCount)
@@ -162,22 +186,19 @@ void FCrimItemTagStackContainer::SubtractStack(FGameplayTag Tag, int32 DeltaCoun
 		return;
 	}
 
-	for (auto It = Items.CreateIterator(); It; ++It)
+	const int32 Index = LowerBound(Tag);
+	if (Items.IsValidIndex(Index) && Items[Index].Tag == Tag)
 	{
-		FCrimItemTagStack& Stack = *It;
-		if (Stack.Tag == Tag)
+		if (Items[Index].Count - DeltaCount == 0)
 		{
-			if (Stack.Count - DeltaCount == 0)
-			{
-				// remove the tag entirely since the value is 0.
-				It.RemoveCurrent();
-			}
-			else
-			{
-				// decrease the stack count
-				Stack.Count -= DeltaCount;
-			}
-			return;
+			// remove the tag entirely since the value is 0.
+			Items.RemoveAt(Index);
+			bTagCacheDirty = true;
+		}
+		else
+		{
+			// decrease the stack count
+			Items[Index].Count -= DeltaCount;
 		}
 	}
 }
@@ -190,25 +211,20 @@ void FCrimItemTagStackContainer::RemoveStack(FGameplayTag Tag)
 		return;
 	}
 
-	for (auto It = Items.CreateIterator(); It; ++It)
+	const int32 Index = LowerBound(Tag);
+	if (Items.IsValidIndex(Index) && Items[Index].Tag == Tag)
 	{
-		FCrimItemTagStack& Stack = *It;
-		if (Stack.Tag == Tag)
-		{
-			It.RemoveCurrent();
-			return;
-		}
+		Items.RemoveAt(Index);
+		bTagCacheDirty = true;
 	}
 }
 
 int32 FCrimItemTagStackContainer::GetStackCount(FGameplayTag Tag) const
 {
-	for (const auto& Item : Items)
+	const int32 Index = LowerBound(Tag);
+	if (Items.IsValidIndex(Index) && Items[Index].Tag.MatchesTagExact(Tag))
 	{
-		if (Item.Tag.MatchesTagExact(Tag))
-		{
-			return Item.Count;
-		}
+		return Items[Index].Count;
 	}
 	return 0;
 }
@@ -223,6 +239,11 @@ FString FCrimItemTagStackContainer::ToDebugString() const
 	return FString::Join(StackStrings, TEXT(", "));
 }
 
+SIZE_T FCrimItemTagStackContainer::GetAllocatedSize() const
+{
+	return Items.GetAllocatedSize();
+}
+
 const TArray<FCrimItemTagStack>& FCrimItemTagStackContainer::GetTagStats() const
 {
 	return Items;
@@ -230,27 +251,92 @@ const TArray<FCrimItemTagStack>& FCrimItemTagStackContainer::GetTagStats() const
 
 bool FCrimItemTagStackContainer::ContainsTag(FGameplayTag Tag, bool bExactMatch) const
 {
-	for (const auto& Item : Items)
+	if (bExactMatch)
 	{
-		if (bExactMatch)
-		{
-			if (Item.Tag.MatchesTagExact(Tag))
-			{
-				return true;
-			}
-		}
-		else
-		{
-			if(Item.Tag.MatchesTag(Tag))
-			{
-				return true;
-			}	
-		}
+		const int32 Index = LowerBound(Tag);
+		return Items.IsValidIndex(Index) && Items[Index].Tag.MatchesTagExact(Tag);
 	}
-	return false;
+
+	ConditionalRebuildTagCache();
+	return TagCache.HasTag(Tag);
 }
 
 void FCrimItemTagStackContainer::Empty()
 {
 	Items.Empty();
+	TagCache.Reset();
+	bTagCacheDirty = false;
+}
+
+void FCrimItemTagStackContainer::RefreshCachedState()
+{
+	auto TagLess = [](const FCrimItemTagStack& A, const FCrimItemTagStack& B)
+	{
+		return A.Tag.GetTagName().FastLess(B.Tag.GetTagName());
+	};
+	if (!Algo::IsSorted(Items, TagLess))
+	{
+		Algo::Sort(Items, TagLess);
+	}
+	bTagCacheDirty = true;
+}
+
+void FCrimItemTagStackContainer::PostSerialize(const FArchive& Ar)
+{
+	if (Ar.IsLoading())
+	{
+		RefreshCachedState();
+	}
+}
+
+bool FCrimItemTagStackContainer::NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess)
+{
+	uint32 NumStacks = Items.Num();
+	Ar.SerializeIntPacked(NumStacks);
+	if (Ar.IsLoading())
+	{
+		if (NumStacks > CrimItem::MaxNetTagStacks)
+		{
+			Ar.SetError();
+			bOutSuccess = false;
+			return false;
+		}
+		Items.SetNum(NumStacks);
+	}
+
+	bOutSuccess = true;
+	for (FCrimItemTagStack& Stack : Items)
+	{
+		bool bTagSuccess = true;
+		Stack.Tag.NetSerialize(Ar, Map, bTagSuccess);
+		CrimItem::NetSerializePackedInt(Ar, Stack.Count);
+		bOutSuccess &= bTagSuccess;
+	}
+
+	if (Ar.IsLoading())
+	{
+		RefreshCachedState();
+	}
+	return true;
+}
+
+int32 FCrimItemTagStackContainer::LowerBound(const FGameplayTag& Tag) const
+{
+	return Algo::LowerBoundBy(Items, Tag.GetTagName(), [](const FCrimItemTagStack& Stack) { return Stack.Tag.GetTagName(); },
+		[](const FName& A, const FName& B) { return A.FastLess(B); });
+}
+
+void FCrimItemTagStackContainer::ConditionalRebuildTagCache() const
+{
+	if (!bTagCacheDirty)
+	{
+		return;
+	}
+
+	TagCache.Reset();
+	for (const FCrimItemTagStack& Stack : Items)
+	{
+		TagCache.AddTag(Stack.Tag);
+	}
+	bTagCacheDirty = false;
 }
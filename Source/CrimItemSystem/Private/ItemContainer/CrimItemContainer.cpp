@@ -97,7 +97,8 @@ int32 UCrimItemContainer::GetMaxCapacity() const
 
 int32 UCrimItemContainer::GetConsumedCapacity() const
 {
-	return GetItemList().GetNum();
+	const FPlannedAdditions* Planned = GetPlannedAdditions();
+	return GetItemList().GetNum() + (Planned ? Planned->NumNewItems : 0);
 }
 
 int32 UCrimItemContainer::GetRemainingCapacity() const
@@ -120,7 +121,12 @@ int32 UCrimItemContainer::GetRemainingCollectionCapacityForItem(const TInstanced
 		MaxQuantity = Fragment->CollectionLimit.GetMaxQuantity();
 	}
 
-	int32 ItemCount = GetItemManagerComponent()->GetItemsByDefinition(UCrimItemStatics::GetItemDefinition(TestItem)).Num();
+	const FCrimItemDefinitionHandle ItemDefinition = TestItem.Get<FCrimItem>().GetItemDefinitionHandle();
+	int32 ItemCount = GetItemManagerComponent()->GetItemStackCountByDefinition(ItemDefinition);
+	if (const FPlannedAdditions* Planned = GetPlannedAdditions())
+	{
+		ItemCount += Planned->NewItemsByDefinition.FindRef(ItemDefinition);
+	}
 	
 	return MaxQuantity - ItemCount;
 }
@@ -141,9 +147,11 @@ int32 UCrimItemContainer::GetRemainingCapacityForItem(const TInstancedStruct<FCr
 		AvailableQuantity = MAX_int32;
 	}
 	
-	for (const FFastCrimItem* Entry : GetItemsByDefinition(UCrimItemStatics::GetItemDefinition(TestItem)))
+	const FCrimItemDefinitionHandle ItemDefinition = TestItem.Get<FCrimItem>().GetItemDefinitionHandle();
+	AvailableQuantity = AvailableQuantity - GetItemList().GetQuantityByDefinition(ItemDefinition);
+	if (const FPlannedAdditions* Planned = GetPlannedAdditions())
 	{
-		AvailableQuantity = AvailableQuantity - Entry->Item.GetPtr<FCrimItem>()->Quantity;
+		AvailableQuantity = AvailableQuantity - Planned->QuantityByDefinition.FindRef(ItemDefinition);
 	}
 	
 	return AvailableQuantity;
@@ -172,10 +180,10 @@ bool UCrimItemContainer::IsItemAtContainerLimit(const TInstancedStruct<FCrimItem
 {
 	if (TestItem.IsValid())
 	{
-		TArray<FFastCrimItem*> Items = GetItemsByDefinition(UCrimItemStatics::GetItemDefinition(TestItem));
+		const int32 NumStacks = GetItemList().GetStackCountByDefinition(TestItem.Get<FCrimItem>().GetItemDefinitionHandle());
 		int32 MaxStacks = GetItemContainerLimit(TestItem);
 
-		if (Items.Num() >= MaxStacks)
+		if (NumStacks >= MaxStacks)
 		{
 			return true;
 		}
@@ -212,7 +220,7 @@ bool UCrimItemContainer::CanSplitItemStack(const TInstancedStruct<FCrimItem>& Te
 
 	const FCrimItem* TestItemPtr = TestItem.GetPtr<FCrimItem>();
 
-	if (TestItemPtr->Quantity <= 1)
+	if (TestItemPtr->Quantity <= 1 || Quantity <= 0)
 	{
 		return false;
 	}
@@ -242,31 +250,59 @@ bool UCrimItemContainer::CanSplitItemStack(const TInstancedStruct<FCrimItem>& Te
 
 void UCrimItemContainer::SplitItemStack(const FGuid& ItemId, int32 Quantity)
 {
-	if (!HasAuthority() || !ItemId.IsValid())
+	if (!ItemId.IsValid())
 	{
 		return;
 	}
 
+	if (HasAuthority())
+	{
+		Internal_SplitItemStack(ItemId, Quantity, FGuid::NewGuid());
+	}
+	else if (CanPredictItemChanges())
+	{
+		// The server gives its copy of the new item the same Guid, so it replaces the predicted one.
+		const FGuid NewItemGuid = FGuid::NewGuid();
+		BeginPrediction();
+		Internal_SplitItemStack(ItemId, Quantity, NewItemGuid);
+		const int32 PredictionKey = EndPrediction();
+		if (PredictionKey != INDEX_NONE)
+		{
+			GetItemManagerComponent()->ServerSplitItemStack(this, ItemId, Quantity, NewItemGuid, PredictionKey);
+		}
+	}
+}
+
+bool UCrimItemContainer::Internal_SplitItemStack(const FGuid& ItemId, int32 Quantity, const FGuid& NewItemGuid)
+{
 	FFastCrimItem* FastItem = GetItemByGuid(ItemId);
 
-	if (FastItem == nullptr)
+	if (FastItem == nullptr || !NewItemGuid.IsValid())
 	{
-		return;
+		return false;
 	}
 
 	if (!CanSplitItemStack(FastItem->Item, Quantity))
 	{
-		return;
+		return false;
 	}
 
+	// The NewItemGuid comes from the client when the split was predicted.
+	if (GetItemManagerComponent() && GetItemManagerComponent()->GetItemByGuid(NewItemGuid))
+	{
+		return false;
+	}
+
+	RecordPredictedChange(*FastItem);
 	FCrimItem* SourceItem = FastItem->Item.GetMutablePtr<FCrimItem>();
 
-	TInstancedStruct<FCrimItem> NewItem = DuplicateItem(FastItem->Item);
+	TInstancedStruct<FCrimItem> NewItem = DuplicateItemWithGuid(FastItem->Item, NewItemGuid);
 	NewItem.GetMutablePtr<FCrimItem>()->Quantity = Quantity;
 	SourceItem->Quantity = SourceItem->Quantity - Quantity;
-	MarkItemDirty(*FastItem);
+	MarkItemDirty(*FastItem, ECrimItemNetSection::Quantity);
 	
 	Internal_AddItem(NewItem);
+	return true;
 }
 
 bool UCrimItemContainer::CanStackItems(const TInstancedStruct<FCrimItem>& SourceItem,
@@ -300,38 +336,60 @@ bool UCrimItemContainer::CanStackItems(const TInstancedStruct<FCrimItem>& Source
 
 void UCrimItemContainer::StackItems(const FGuid& SourceItemId, const FGuid& TargetItemId, int32 Quantity)
 {
-	if (!HasAuthority() || !SourceItemId.IsValid() || !TargetItemId.IsValid())
+	if (!SourceItemId.IsValid() || !TargetItemId.IsValid())
 	{
 		return;
 	}
 
+	if (HasAuthority())
+	{
+		Internal_StackItems(SourceItemId, TargetItemId, Quantity);
+	}
+	else if (CanPredictItemChanges())
+	{
+		BeginPrediction();
+		Internal_StackItems(SourceItemId, TargetItemId, Quantity);
+		const int32 PredictionKey = EndPrediction();
+		if (PredictionKey != INDEX_NONE)
+		{
+			GetItemManagerComponent()->ServerStackItems(this, SourceItemId, TargetItemId, Quantity, PredictionKey);
+		}
+	}
+}
+
+bool UCrimItemContainer::Internal_StackItems(const FGuid& SourceItemId, const FGuid& TargetItemId, int32 Quantity)
+{
 	FFastCrimItem* SourceFastItem = GetItemByGuid(SourceItemId);
 	FFastCrimItem* TargetFastItem = GetItemByGuid(TargetItemId);
 
-	if (SourceFastItem == nullptr || TargetFastItem == nullptr)
+	if (SourceFastItem == nullptr || TargetFastItem == nullptr || Quantity <= 0)
 	{
-		return;
+		return false;
 	}
 
 	int32 MaxTransferAmount = 0;
 	if (!CanStackItems(SourceFastItem->Item, TargetFastItem->Item, MaxTransferAmount))
 	{
-		return;
+		return false;
 	}
 
 	int32 TransferAmount = FMath::Min(MaxTransferAmount, Quantity);
-	
+
+	RecordPredictedChange(*SourceFastItem);
+	RecordPredictedChange(*TargetFastItem);
+	FCrimItemBatchScope BatchScope(this);
 	FCrimItem* SourceItemPtr = SourceFastItem->Item.GetMutablePtr<FCrimItem>();
 	FCrimItem* TargetItemPtr = TargetFastItem->Item.GetMutablePtr<FCrimItem>();
 	SourceItemPtr->Quantity = SourceItemPtr->Quantity - TransferAmount;
+	MarkItemDirty(*SourceFastItem, ECrimItemNetSection::Quantity);
 	TargetItemPtr->Quantity = TargetItemPtr->Quantity + TransferAmount;
-	MarkItemDirty(*SourceFastItem);
-	MarkItemDirty(*TargetFastItem);
+	MarkItemDirty(*TargetFastItem, ECrimItemNetSection::Quantity);
 
 	if (SourceItemPtr->Quantity <= 0)
 	{
 		Internal_RemoveItem(SourceItemPtr->GetItemGuid());
 	}
+	return true;
 }
 
 
@@ -349,32 +407,29 @@ FCrimAddItemPlan UCrimItemContainer::GetAddItemPlan(const TInstancedStruct<FCrim
 	const int32 ItemStackMaxQuantity = GetItemQuantityLimit(Item);
 
 	//----------------------------------------------------------------------------------------------
-	// 2. If auto stacking gather a list of all matching items in the list. We only try to auto
-	// stack if the ItemStackMaxQuantity is greater than 1 and auto stacking is enabled.
-	//----------------------------------------------------------------------------------------------
-	TArray<FFastCrimItem*> MatchingItems = TArray<FFastCrimItem*>();
-	if (bAutoStack && ItemStackMaxQuantity > 1)
-	{
-		MatchingItems = FindMatchingItems(Item);
-	}
-
-	//----------------------------------------------------------------------------------------------
+	// 2. If auto stacking visit all matching items in the list. We only try to auto stack if the
+	// ItemStackMaxQuantity is greater than 1 and auto stacking is enabled.
 	// 3. We add item quantities to existing items that are not at their max capacity for a single stack.
 	//----------------------------------------------------------------------------------------------
-	for (FFastCrimItem*& Match : MatchingItems)
+	if (bAutoStack && ItemStackMaxQuantity > 1)
 	{
-		if (RemainingQuantityToAdd < 0)
+		const FPlannedAdditions* Planned = GetPlannedAdditions();
+		ForEachMatchingItemBelowQuantity(Item, ItemStackMaxQuantity, [&Result, &RemainingQuantityToAdd, ItemStackMaxQuantity, Planned](FFastCrimItem& Match)
 		{
-			break;
-		}
+			if (RemainingQuantityToAdd <= 0)
+			{
+				return false;
+			}
 
-		const FCrimItem* ItemPtr = Match->Item.GetPtr<FCrimItem>();
-		if (ItemPtr->Quantity < ItemStackMaxQuantity)
-		{
-			const int32 QuantityToAdd = FMath::Min(RemainingQuantityToAdd, ItemStackMaxQuantity - ItemPtr->Quantity);
-			RemainingQuantityToAdd = RemainingQuantityToAdd - QuantityToAdd;
-			Result.AddEntry(FCrimAddItemPlanEntry(Match, QuantityToAdd));
-		}
+			const int32 Quantity = Match.Item.Get<FCrimItem>().Quantity + (Planned ? Planned->QuantityByItem.FindRef(&Match) : 0);
+			if (Quantity < ItemStackMaxQuantity)
+			{
+				const int32 QuantityToAdd = FMath::Min(RemainingQuantityToAdd, ItemStackMaxQuantity - Quantity);
+				RemainingQuantityToAdd = RemainingQuantityToAdd - QuantityToAdd;
+				Result.AddEntry(FCrimAddItemPlanEntry(&Match, QuantityToAdd));
+			}
+			return true;
+		});
 	}
 
 	if (RemainingQuantityToAdd <= 0)
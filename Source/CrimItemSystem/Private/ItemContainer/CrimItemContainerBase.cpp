@@ -6,6 +6,7 @@
 #include "CrimItemDefinition.h"
 #include "CrimItemGameplayTags.h"
 #include "CrimItemManagerComponent.h"
+#include "GameFramework/Actor.h"
 #include "Net/UnrealNetwork.h"
 #include "UI/ViewModel/CrimItemContainerViewModel.h"
 
@@ -18,6 +19,11 @@ void UCrimItemContainerBase::PostInitProperties()
 {
 	UObject::PostInitProperties();
 
+	ItemList.SetOwningContainer(this);
+	ItemList.SetKeepPreReplicatedItems(bKeepPreReplicatedItems);
+	ItemList.SetMinShrinkCapacity(MinShrinkCapacity);
+	ItemList.SetMaxNewItemsPerNetUpdate(MaxNewItemsPerNetUpdate);
+	ItemList.SetMaxNewItemBytesPerNetUpdate(MaxNewItemBytesPerNetUpdate);
 	BindToItemListDelegates();
 }
 
@@ -32,14 +38,68 @@ void UCrimItemContainerBase::GetLifetimeReplicatedProps(TArray<class FLifetimePr
 	DOREPLIFETIME_WITH_PARAMS_FAST(ThisClass, ItemList, Params);
 }
 
+void UCrimItemContainerBase::GetResourceSizeEx(FResourceSizeEx& CumulativeResourceSize)
+{
+	UObject::GetResourceSizeEx(CumulativeResourceSize);
+
+	CumulativeResourceSize.AddDedicatedSystemMemoryBytes(ItemList.GetAllocatedSize() +
+		PendingRemovedItems.GetAllocatedSize() +
+		PendingDirtyItems.GetAllocatedSize() +
+		PendingAddedItems.GetAllocatedSize() +
+		RemovedWhileBatchingItems.GetAllocatedSize() +
+		PendingPredictions.GetAllocatedSize() +
+		PredictedRemovedItems.GetAllocatedSize());
+}
+
 #if UE_WITH_IRIS
 void UCrimItemContainerBase::RegisterReplicationFragments(UE::Net::FFragmentRegistrationContext& Context,
 	UE::Net::EFragmentRegistrationFlags RegistrationFlags)
 {
+	// The ItemList gets an Iris fast array fragment, which keeps a change mask per item so only dirty items are
+	// quantized. FFastCrimItem has a NetSerialize, so Iris forwards each whole item to it, including its
+	// FCrimItemTagStackContainer, rather than using native serializers for the nested structs. A native NetSerializer
+	// for FCrimItem is not provided, see FFastCrimItemList.
 	UE::Net::FReplicationFragmentUtil::CreateAndRegisterFragmentsForObject(this, Context, RegistrationFlags);
 }
 #endif
 
+ELifetimeCondition UCrimItemContainerBase::GetReplicationCondition() const
+{
+	switch (ReplicationPolicy)
+	{
+	case ECrimItemContainerReplication::OwnerOnly:
+		return COND_OwnerOnly;
+	case ECrimItemContainerReplication::NetConditionGroup:
+		return COND_NetGroup;
+	default:
+		return COND_None;
+	}
+}
+
+void UCrimItemContainerBase::PrioritizeItemReplication(FGuid ItemGuid)
+{
+	if (FFastCrimItem* FastItem = ItemList.GetItem(ItemGuid))
+	{
+		ItemList.PrioritizeItemReplication(*FastItem);
+	}
+}
+
+const FCrimItemNetBacklogStats& UCrimItemContainerBase::GetNetBacklogStats() const
+{
+	return ItemList.GetNetBacklogStats();
+}
+
+bool UCrimItemContainerBase::CanPredictItemChanges() const
+{
+	if (!bAllowClientPrediction || HasAuthority() || !IsValid(ItemManagerComponent))
+	{
+		return false;
+	}
+	// The change is sent to the server with an RPC, which requires the ItemManager's actor to be owned by this client.
+	const AActor* Owner = ItemManagerComponent->GetOwner();
+	return Owner && Owner->GetNetConnection() != nullptr;
+}
+
 const FGameplayTag& UCrimItemContainerBase::GetContainerGuid() const
 {
 	return ContainerGuid;
@@ -62,12 +122,17 @@ const TArray<FFastCrimItem>& UCrimItemContainerBase::GetItems() const
 
 FFastCrimItem* UCrimItemContainerBase::GetItemByGuid(FGuid ItemGuid) const
 {
-	return ItemList.GetItem(ItemGuid);
+	FFastCrimItem* FastItem = ItemList.GetItem(ItemGuid);
+	if (FastItem && IsPendingRemoval(*FastItem))
+	{
+		return nullptr;
+	}
+	return FastItem;
 }
 
 TInstancedStruct<FCrimItem> UCrimItemContainerBase::K2_GetItemByGuid(FGuid ItemGuid) const
 {
-	if (FFastCrimItem* FastItem = ItemList.GetItem(ItemGuid))
+	if (FFastCrimItem* FastItem = GetItemByGuid(ItemGuid))
 	{
 		return FastItem->Item;
 	}
@@ -75,97 +140,101 @@ TInstancedStruct<FCrimItem> UCrimItemContainerBase::K2_GetItemByGuid(FGuid ItemG
 	return TInstancedStruct<FCrimItem>();
 }
 
-FFastCrimItem* UCrimItemContainerBase::GetItemByDefinition(const UCrimItemDefinition* ItemDefinition) const
+void UCrimItemContainerBase::ForEachItem(TFunctionRef<bool(FFastCrimItem&)> Func) const
+{
+	ItemList.ForEachItem([this, &Func](FFastCrimItem& FastItem)
+	{
+		return IsPendingRemoval(FastItem) || Func(FastItem);
+	});
+}
+
+void UCrimItemContainerBase::ForEachItemByDefinition(const UCrimItemDefinition* ItemDefinition, TFunctionRef<bool(FFastCrimItem&)> Func) const
 {
 	if (ItemDefinition)
 	{
-		for (const FFastCrimItem& Entry : ItemList.GetItems())
+		ItemList.ForEachItemByDefinition(ItemDefinition->GetItemDefinitionHandle(), [this, &Func](FFastCrimItem& FastItem)
 		{
-			if (Entry.Item.GetPtr<FCrimItem>()->GetItemDefinition()->GetPathName() == ItemDefinition->GetPathName())
-			{
-				return const_cast<FFastCrimItem*>(&Entry);
-			}
-		}
+			return IsPendingRemoval(FastItem) || Func(FastItem);
+		});
 	}
-	return nullptr;
+}
+
+void UCrimItemContainerBase::ForEachMatchingItem(const TInstancedStruct<FCrimItem>& TestItem, TFunctionRef<bool(FFastCrimItem&)> Func) const
+{
+	ItemList.ForEachMatchingItem(TestItem, [this, &Func](FFastCrimItem& FastItem)
+	{
+		return IsPendingRemoval(FastItem) || Func(FastItem);
+	});
+}
+
+void UCrimItemContainerBase::ForEachMatchingItemBelowQuantity(const TInstancedStruct<FCrimItem>& TestItem, int32 MaxQuantity,
+	TFunctionRef<bool(FFastCrimItem&)> Func) const
+{
+	ItemList.ForEachMatchingItemBelowQuantity(TestItem, MaxQuantity, [this, &Func](FFastCrimItem& FastItem)
+	{
+		return IsPendingRemoval(FastItem) || Func(FastItem);
+	});
+}
+
+FFastCrimItem* UCrimItemContainerBase::GetItemByDefinition(const UCrimItemDefinition* ItemDefinition) const
+{
+	FFastCrimItem* Result = nullptr;
+	ForEachItemByDefinition(ItemDefinition, [&Result](FFastCrimItem& FastItem)
+	{
+		Result = &FastItem;
+		return false;
+	});
+	return Result;
 }
 
 TInstancedStruct<FCrimItem> UCrimItemContainerBase::K2_GetItemByDefinition(const UCrimItemDefinition* ItemDefinition) const
 {
-	if (ItemDefinition)
+	if (FFastCrimItem* FastItem = GetItemByDefinition(ItemDefinition))
 	{
-		for (const FFastCrimItem& Entry : ItemList.GetItems())
-		{
-			if (Entry.Item.GetPtr<FCrimItem>()->GetItemDefinition()->GetPathName() == ItemDefinition->GetPathName())
-			{
-				return Entry.Item;
-			}
-		}
+		return FastItem->Item;
 	}
 	return TInstancedStruct<FCrimItem>();
 }
 
 TArray<FFastCrimItem*> UCrimItemContainerBase::GetItemsByDefinition(const UCrimItemDefinition* ItemDefinition) const
 {
-	TArray<FFastCrimItem*> Items;
-
-	if (ItemDefinition)
+	TArray<FFastCrimItem*> Result;
+	ForEachItemByDefinition(ItemDefinition, [&Result](FFastCrimItem& FastItem)
 	{
-		for (const FFastCrimItem& Entry : ItemList.GetItems())
-		{
-			if (Entry.Item.GetPtr<FCrimItem>()->GetItemDefinition()->GetPathName() == ItemDefinition->GetPathName())
-			{
-				Items.Add(const_cast<FFastCrimItem*>(&Entry));
-			}
-		}
-	}
-	return Items;
+		Result.Add(&FastItem);
+		return true;
+	});
+	return Result;
 }
 
 TArray<TInstancedStruct<FCrimItem>> UCrimItemContainerBase::K2_GetItemsByDefinition(
 	const UCrimItemDefinition* ItemDefinition) const
 {
 	TArray<TInstancedStruct<FCrimItem>> Items;
-
-	if (ItemDefinition)
+	ForEachItemByDefinition(ItemDefinition, [&Items](const FFastCrimItem& FastItem)
 	{
-		for (const FFastCrimItem& Entry : ItemList.GetItems())
-		{
-			if (Entry.Item.GetPtr<FCrimItem>()->GetItemDefinition()->GetPathName() == ItemDefinition->GetPathName())
-			{
-				Items.Add(Entry.Item);
-			}
-		}
-	}
+		Items.Add(FastItem.Item);
+		return true;
+	});
 	return Items;
 }
 
 FFastCrimItem* UCrimItemContainerBase::FindMatchingItem(const TInstancedStruct<FCrimItem>& TestItem) const
 {
-	if (TestItem.IsValid())
+	FFastCrimItem* Result = nullptr;
+	ForEachMatchingItem(TestItem, [&Result](FFastCrimItem& FastItem)
 	{
-		for (const FFastCrimItem& Entry : ItemList.GetItems())
-		{
-			if (Entry.Item.GetPtr<FCrimItem>()->IsMatching(TestItem))
-			{
-				return const_cast<FFastCrimItem*>(&Entry);
-			}
-		}
-	}
-	return nullptr;
+		Result = &FastItem;
+		return false;
+	});
+	return Result;
 }
 
 TInstancedStruct<FCrimItem> UCrimItemContainerBase::K2_FindMatchingItem( const TInstancedStruct<FCrimItem>& TestItem) const
 {
-	if (TestItem.IsValid())
+	if (const FFastCrimItem* FastItem = FindMatchingItem(TestItem))
 	{
-		for (const FFastCrimItem& Entry : ItemList.GetItems())
-		{
-			if (Entry.Item.GetPtr<FCrimItem>()->IsMatching(TestItem))
-			{
-				return Entry.Item;
-			}
-		}
+		return FastItem->Item;
 	}
 	return TInstancedStruct<FCrimItem>();
 }
@@ -173,32 +242,22 @@ TInstancedStruct<FCrimItem> UCrimItemContainerBase::K2_FindMatchingItem( const T
 TArray<FFastCrimItem*> UCrimItemContainerBase::FindMatchingItems(const TInstancedStruct<FCrimItem>& TestItem) const
 {
 	TArray<FFastCrimItem*> Result;
-	if (TestItem.IsValid())
+	ForEachMatchingItem(TestItem, [&Result](FFastCrimItem& FastItem)
 	{
-		for (const FFastCrimItem& Entry : ItemList.GetItems())
-		{
-			if (Entry.Item.GetPtr<FCrimItem>()->IsMatching(TestItem))
-			{
-				Result.Add(const_cast<FFastCrimItem*>(&Entry));
-			}
-		}
-	}
+		Result.Add(&FastItem);
+		return true;
+	});
 	return Result;
 }
 
 TArray<TInstancedStruct<FCrimItem>> UCrimItemContainerBase::K2_FindMatchingItems( const TInstancedStruct<FCrimItem>& TestItem) const
 {
 	TArray<TInstancedStruct<FCrimItem>> Result;
-	if (TestItem.IsValid())
+	ForEachMatchingItem(TestItem, [&Result](const FFastCrimItem& FastItem)
 	{
-		for (const FFastCrimItem& Entry : ItemList.GetItems())
-		{
-			if (Entry.Item.GetPtr<FCrimItem>()->IsMatching(TestItem))
-			{
-				Result.Add(Entry.Item);
-			}
-		}
-	}
+		Result.Add(FastItem.Item);
+		return true;
+	});
 	return Result;
 }
 
@@ -220,6 +279,7 @@ TInstancedStruct<FCrimItem> UCrimItemContainerBase::CreateItem(const UCrimItemDe
 	{
 		Fragment.Get<FCrimItemDefinitionFragment>().SetDefaultValues(Result);
 	}
+	ItemPtr->RefreshCachedState();
 	return Result;
 }
 
@@ -241,20 +301,62 @@ TInstancedStruct<FCrimItem> UCrimItemContainerBase::DuplicateItem(const TInstanc
 	return Result;
 }
 
+TInstancedStruct<FCrimItem> UCrimItemContainerBase::DuplicateItemWithGuid(const TInstancedStruct<FCrimItem>& Item, const FGuid& NewItemGuid)
+{
+	TInstancedStruct<FCrimItem> Result = DuplicateItem(Item);
+	if (Result.IsValid())
+	{
+		Result.GetMutablePtr<FCrimItem>()->ItemGuid = NewItemGuid;
+	}
+	return Result;
+}
+
 FCrimAddItemResult UCrimItemContainerBase::TryAddItem(const TInstancedStruct<FCrimItem>& Item)
 {
-	FCrimAddItemResult Result;
+	return ExecutePlan(Item, PlanAddItem(Item));
+}
+
+TArray<FCrimAddItemResult> UCrimItemContainerBase::TryAddItems(TArrayView<const TInstancedStruct<FCrimItem>> Items)
+{
+	TArray<FCrimAddItemResult> Result;
+	Result.Reserve(Items.Num());
 
-	if (!CanAddItem(Item, Result.Error))
+	TArray<FCrimAddItemPlan> Plans = PlanAddItems(Items);
+	if (HasAuthority())
 	{
-		return Result;
+		int32 NumNewItems = 0;
+		for (const FCrimAddItemPlan& Plan : Plans)
+		{
+			for (const FCrimAddItemPlanEntry& Entry : Plan.GetEntries())
+			{
+				NumNewItems += Entry.FastItemPtr == nullptr && Entry.IsValid() ? 1 : 0;
+			}
+		}
+
+		// Reserved up front, so adding the new items does not move the existing items the plans point to.
+		const uint32 Version = GetModificationVersion();
+		ItemList.Reserve(ItemList.GetNum() + NumNewItems);
+		if (GetModificationVersion() != Version)
+		{
+			Plans = PlanAddItems(Items);
+		}
 	}
 
-	FCrimAddItemPlan AddItemPlan = GetAddItemPlan(Item);
-	Result = FCrimAddItemResult(AddItemPlan, ExecuteAddItemPlan(Item, AddItemPlan));
+	// The plans were built against the same state, so they are executed without checking them against the version.
+	FCrimItemBatchScope BatchScope(this);
+	for (int32 i = 0; i < Items.Num(); i++)
+	{
+		const FCrimAddItemPlan& Plan = Plans[i];
+		Result.Add(FCrimAddItemResult(Plan, Plan.IsValid() ? ExecuteAddItemPlan(Items[i], Plan) : TArray<TInstancedStruct<FCrimItem>>()));
+	}
 	return Result;
 }
 
+TArray<FCrimAddItemResult> UCrimItemContainerBase::K2_TryAddItems(const TArray<TInstancedStruct<FCrimItem>>& Items)
+{
+	return TryAddItems(Items);
+}
+
 bool UCrimItemContainerBase::CanAddItem(const TInstancedStruct<FCrimItem>& Item, FGameplayTag& OutError) const
 {
 	if (!HasAuthority())
@@ -273,30 +375,158 @@ bool UCrimItemContainerBase::CanAddItem(const TInstancedStruct<FCrimItem>& Item,
 	return true;
 }
 
+FCrimAddItemPlan UCrimItemContainerBase::PlanAddItem(const TInstancedStruct<FCrimItem>& Item) const
+{
+	FCrimAddItemPlan Result;
+	FGameplayTag Error;
+	if (CanAddItem(Item, Error))
+	{
+		Result = GetAddItemPlan(Item);
+	}
+	else
+	{
+		Result.Error = Error;
+	}
+
+	Result.ItemContainer = const_cast<UCrimItemContainerBase*>(this);
+	Result.ItemContainerVersion = GetModificationVersion();
+	Result.ItemManagerVersion = IsValid(ItemManagerComponent) ? ItemManagerComponent->GetItemIndexVersion() : 0;
+	if (const FCrimItem* ItemPtr = Item.GetPtr<FCrimItem>())
+	{
+		Result.ItemGuid = ItemPtr->GetItemGuid();
+	}
+	return Result;
+}
+
+TArray<FCrimAddItemPlan> UCrimItemContainerBase::PlanAddItems(TArrayView<const TInstancedStruct<FCrimItem>> Items) const
+{
+	TArray<FCrimAddItemPlan> Result;
+	Result.Reserve(Items.Num());
+
+	FPlannedAdditions Planned;
+	TGuardValue<const FPlannedAdditions*> PlannedAdditionsGuard(PlannedAdditions, &Planned);
+	for (const TInstancedStruct<FCrimItem>& Item : Items)
+	{
+		const FCrimAddItemPlan& Plan = Result.Add_GetRef(PlanAddItem(Item));
+		Planned.Add(Item, Plan);
+	}
+	return Result;
+}
+
+void UCrimItemContainerBase::FPlannedAdditions::Add(const TInstancedStruct<FCrimItem>& Item, const FCrimAddItemPlan& AddItemPlan)
+{
+	if (!AddItemPlan.IsValid())
+	{
+		return;
+	}
+
+	const FCrimItemDefinitionHandle ItemDefinition = Item.Get<FCrimItem>().GetItemDefinitionHandle();
+	QuantityByDefinition.FindOrAdd(ItemDefinition) += AddItemPlan.AmountGiven;
+	for (const FCrimAddItemPlanEntry& Entry : AddItemPlan.GetEntries())
+	{
+		if (Entry.FastItemPtr)
+		{
+			QuantityByItem.FindOrAdd(Entry.FastItemPtr) += Entry.QuantityToAdd;
+		}
+		else if (Entry.IsValid())
+		{
+			NewItemsByDefinition.FindOrAdd(ItemDefinition)++;
+			NumNewItems++;
+		}
+	}
+}
+
+FCrimAddItemResult UCrimItemContainerBase::ExecutePlan(const TInstancedStruct<FCrimItem>& Item, const FCrimAddItemPlan& AddItemPlan)
+{
+	FCrimAddItemResult Result;
+	if (!HasAuthority())
+	{
+		Result.Error = FCrimItemGameplayTags::Get().ItemPlan_Error;
+		return Result;
+	}
+
+	if (!IsPlanCurrent(AddItemPlan))
+	{
+		Result.Error = FCrimItemGameplayTags::Get().ItemPlan_Error_StalePlan;
+		return Result;
+	}
+
+	if (!Item.IsValid() || Item.Get<FCrimItem>().GetItemGuid() != AddItemPlan.ItemGuid)
+	{
+		Result.Error = FCrimItemGameplayTags::Get().ItemPlan_Error_InvalidItem;
+		return Result;
+	}
+
+	if (!AddItemPlan.IsValid())
+	{
+		return FCrimAddItemResult(AddItemPlan, TArray<TInstancedStruct<FCrimItem>>());
+	}
+
+	return FCrimAddItemResult(AddItemPlan, ExecuteAddItemPlan(Item, AddItemPlan));
+}
+
+bool UCrimItemContainerBase::IsPlanCurrent(const FCrimAddItemPlan& AddItemPlan) const
+{
+	// The collection limits depend on the items of the ItemManager's other ItemContainers too.
+	return AddItemPlan.ItemContainer.Get() == this &&
+		AddItemPlan.ItemContainerVersion == GetModificationVersion() &&
+		AddItemPlan.ItemManagerVersion == (IsValid(ItemManagerComponent) ? ItemManagerComponent->GetItemIndexVersion() : 0);
+}
+
+uint32 UCrimItemContainerBase::GetModificationVersion() const
+{
+	return ItemList.GetVersion();
+}
+
 int32 UCrimItemContainerBase::ConsumeItem(const FGuid ItemGuid, const int32 Quantity, bool bRemoveItem)
 {
-	if (ItemGuid.IsValid() || !HasAuthority() || Quantity <= 0)
+	if (!ItemGuid.IsValid() || Quantity <= 0)
 	{
 		return 0;
 	}
 
-	FFastCrimItem* FastItem = ItemList.GetItem(ItemGuid);
-	if (FastItem == nullptr)
+	if (HasAuthority())
+	{
+		return Internal_ConsumeItem(ItemGuid, Quantity, bRemoveItem);
+	}
+
+	if (!CanPredictItemChanges())
+	{
+		return 0;
+	}
+
+	BeginPrediction();
+	const int32 Result = Internal_ConsumeItem(ItemGuid, Quantity, bRemoveItem);
+	const int32 PredictionKey = EndPrediction();
+	if (PredictionKey != INDEX_NONE)
+	{
+		ItemManagerComponent->ServerConsumeItem(this, ItemGuid, Quantity, bRemoveItem, PredictionKey);
+	}
+	return Result;
+}
+
+int32 UCrimItemContainerBase::Internal_ConsumeItem(const FGuid& ItemGuid, int32 Quantity, bool bRemoveItem)
+{
+	FFastCrimItem* FastItem = GetItemByGuid(ItemGuid);
+	if (FastItem == nullptr || Quantity <= 0)
 	{
 		return 0;
 	}
 
+	RecordPredictedChange(*FastItem);
 	FCrimItem* MutableItem = FastItem->Item.GetMutablePtr<FCrimItem>();
 	const int32 NewQuantity = FMath::Max(MutableItem->Quantity - Quantity, 0);
 	const int32 Delta = MutableItem->Quantity - NewQuantity;
 	MutableItem->Quantity = NewQuantity;
 	if (NewQuantity <= 0 && bRemoveItem)
 	{
+		// The removal may be deferred by a batch, keep the totals current in the meantime.
+		ItemList.RefreshItemIndex(*FastItem);
 		Internal_RemoveItem(ItemGuid);
 	}
 	else
 	{
-		MarkItemDirty(*FastItem);
+		MarkItemDirty(*FastItem, ECrimItemNetSection::Quantity);
 	}
 	return Delta;
 }
@@ -309,27 +539,27 @@ int32 UCrimItemContainerBase::ConsumeItemsByDefinition(const UCrimItemDefinition
 	}
 
 	int32 QuantityRemaining = Quantity;
-	for (FFastCrimItem*& FastItem : GetItemsByDefinition(ItemDefinition))
+	// The batch defers the removals, so the items can be removed while iterating.
+	FCrimItemBatchScope BatchScope(this);
+	ForEachItemByDefinition(ItemDefinition, [this, &QuantityRemaining, bRemoveItem](FFastCrimItem& FastItem)
 	{
-		FCrimItem* Item = FastItem->Item.GetMutablePtr<FCrimItem>();
+		FCrimItem* Item = FastItem.Item.GetMutablePtr<FCrimItem>();
 		const int32 NewQuantity = FMath::Max(Item->Quantity - QuantityRemaining, 0);
 		QuantityRemaining = FMath::Max(QuantityRemaining - Item->Quantity, 0);
 		Item->Quantity = NewQuantity;
 
 		if (NewQuantity <= 0 && bRemoveItem)
 		{
+			// The removal is deferred by the batch, keep the totals current in the meantime.
+			ItemList.RefreshItemIndex(FastItem);
 			Internal_RemoveItem(Item->GetItemGuid());
 		}
 		else
 		{
-			MarkItemDirty(*FastItem);
-		}
-
-		if (QuantityRemaining == 0)
-		{
-			return Quantity;
+			MarkItemDirty(FastItem, ECrimItemNetSection::Quantity);
 		}
-	}
+		return QuantityRemaining > 0;
+	});
 	return Quantity - QuantityRemaining;
 }
 
@@ -338,7 +568,7 @@ TInstancedStruct<FCrimItem> UCrimItemContainerBase::RemoveItem(const FGuid ItemG
 	TInstancedStruct<FCrimItem> Result;
 	FFastCrimItem* FastItem = GetItemByGuid(ItemGuid);
 
-	if (!CanRemoveItem(FastItem->Item))
+	if (FastItem == nullptr || !CanRemoveItem(FastItem->Item))
 	{
 		return Result;
 	}
@@ -348,19 +578,93 @@ TInstancedStruct<FCrimItem> UCrimItemContainerBase::RemoveItem(const FGuid ItemG
 	return Result;
 }
 
+FCrimAddItemResult UCrimItemContainerBase::MoveItem(const FGuid ItemGuid, UCrimItemContainerBase* TargetContainer, int32 Quantity)
+{
+	FCrimAddItemResult Result;
+	if (!IsValid(TargetContainer) || TargetContainer == this)
+	{
+		Result.Error = FCrimItemGameplayTags::Get().ItemPlan_Error_ItemContainerNotFound;
+		return Result;
+	}
+
+	FFastCrimItem* FastItem = GetItemByGuid(ItemGuid);
+	if (FastItem == nullptr || !CanRemoveItem(FastItem->Item))
+	{
+		Result.Error = FCrimItemGameplayTags::Get().ItemPlan_Error_InvalidItem;
+		return Result;
+	}
+
+	const int32 StackQuantity = FastItem->Item.Get<FCrimItem>().Quantity;
+	const bool bMoveWholeStack = Quantity <= 0 || Quantity >= StackQuantity;
+
+	TInstancedStruct<FCrimItem> PartialItem;
+	if (!bMoveWholeStack)
+	{
+		PartialItem = FastItem->Item;
+		PartialItem.GetMutablePtr<FCrimItem>()->Quantity = Quantity;
+	}
+	const TInstancedStruct<FCrimItem>& MovedItem = bMoveWholeStack ? FastItem->Item : PartialItem;
+
+	const FCrimAddItemPlan AddItemPlan = TargetContainer->PlanAddItem(MovedItem);
+	if (!AddItemPlan.IsValid() || AddItemPlan.AmountGiven <= 0)
+	{
+		Result.Error = AddItemPlan.Error;
+		return Result;
+	}
+
+	if (AddItemPlan.AmountGiven >= StackQuantity)
+	{
+		const TArray<FCrimAddItemPlanEntry>& Entries = AddItemPlan.GetEntries();
+		const bool bMoveAsNewItem = Entries.Num() == 1 && Entries[0].FastItemPtr == nullptr;
+
+		// The ItemManager announces the removal and the add below as a single move.
+		UCrimItemManagerComponent* MoveItemManager = bMoveAsNewItem && IsValid(ItemManagerComponent) &&
+			TargetContainer->GetItemManagerComponent() == ItemManagerComponent ? ItemManagerComponent.Get() : nullptr;
+		if (MoveItemManager)
+		{
+			MoveItemManager->MovingItemSource = this;
+			MoveItemManager->MovingItemGuid = ItemGuid;
+		}
+
+		// The whole stack is leaving this container. A new item in the TargetContainer keeps the ItemGuid, as it is not
+		// in the TargetContainer. While batching, the removal is deferred and the ItemManager indexes the item in the
+		// TargetContainer until then.
+		const TInstancedStruct<FCrimItem> Item = FastItem->Item;
+		Internal_RemoveItem(ItemGuid);
+		Result = FCrimAddItemResult(AddItemPlan, TargetContainer->ExecuteAddItemPlan(Item, AddItemPlan));
+		if (MoveItemManager)
+		{
+			MoveItemManager->MovingItemSource = nullptr;
+		}
+		return Result;
+	}
+
+	// Part of the stack stays in this container. New items in the TargetContainer need their own ItemGuid.
+	TInstancedStruct<FCrimItem> ItemToAdd = MovedItem;
+	ItemToAdd.GetMutablePtr<FCrimItem>()->ItemGuid = FGuid::NewGuid();
+	Result = FCrimAddItemResult(AddItemPlan, TargetContainer->ExecuteAddItemPlan(ItemToAdd, AddItemPlan));
+
+	// Adding to the TargetContainer does not touch this container, so the FastItem is still valid.
+	FCrimItem* SourceItem = FastItem->Item.GetMutablePtr<FCrimItem>();
+	SourceItem->Quantity = SourceItem->Quantity - AddItemPlan.AmountGiven;
+	MarkItemDirty(*FastItem, ECrimItemNetSection::Quantity);
+	return Result;
+}
+
 TArray<TInstancedStruct<FCrimItem>> UCrimItemContainerBase::RemoveItemsByDefinition(const UCrimItemDefinition* ItemDefinition)
 {
 	TArray<TInstancedStruct<FCrimItem>> Result;
-	TArray<FFastCrimItem*> FastItems = GetItemsByDefinition(ItemDefinition);
-	
-	for (FFastCrimItem* FastItem : FastItems)
+	// The batch defers the removals, so the items can be removed while iterating.
+	FCrimItemBatchScope BatchScope(this);
+	ForEachItemByDefinition(ItemDefinition, [this, &Result](const FFastCrimItem& FastItem)
 	{
-		if (CanRemoveItem(FastItem->Item))
+		if (CanRemoveItem(FastItem.Item))
 		{
-			Result.Add(FastItem->Item);
-			Internal_RemoveItem(FastItem->Item.Get<FCrimItem>().GetItemGuid());	
+			Result.Add(FastItem.Item);
+			Internal_RemoveItem(FastItem.Item.Get<FCrimItem>().GetItemGuid());
 		}
-	}
+		return true;
+	});
 	return Result;
 }
 
@@ -385,14 +689,33 @@ bool UCrimItemContainerBase::CanRemoveItem(const TInstancedStruct<FCrimItem>& It
 	return true;
 }
 
-void UCrimItemContainerBase::MarkItemDirty(FFastCrimItem& FastItem)
+void UCrimItemContainerBase::MarkItemDirty(FFastCrimItem& FastItem, ECrimItemNetSection Sections)
 {
+	// The item may no longer stack with the same items it did before the change.
+	ItemList.RefreshItemIndex(FastItem);
+
+	if (IsBatching() && HasAuthority())
+	{
+		FastItem.PendingNetSections |= Sections;
+		PendingDirtyItems.Add(FastItem.Item.Get<FCrimItem>().GetItemGuid());
+		return;
+	}
+
 	if (HasAuthority() &&
 		FastItem.Item.GetPtr<FCrimItem>()->ItemContainer == this)
 	{
-		ItemList.MarkItemDirty(FastItem);
+		ItemList.MarkItemSectionsDirty(FastItem, FastItem.PendingNetSections | Sections);
+		FastItem.PendingNetSections = ECrimItemNetSection::None;
+		ItemList.OnItemChangedDelegate.Broadcast(FastItem);
+		if (ItemList.IsKeepingPreReplicatedItems())
+		{
+			FastItem.PreReplicatedChangeItem = FastItem.Item;
+		}
+	}
+	else if (IsPredicting())
+	{
+		// Not replicated, the server makes the same change.
 		ItemList.OnItemChangedDelegate.Broadcast(FastItem);
-		FastItem.PreReplicatedChangeItem = FastItem.Item;
 	}
 	else
 	{
@@ -429,13 +752,155 @@ void UCrimItemContainerBase::Internal_AddItem(TInstancedStruct<FCrimItem>& Item)
 		Item.GetMutablePtr<FCrimItem>()->ItemManager = ItemManagerComponent;
 		ItemList.AddItem(Item);
 	}
+	else if (IsPredicting())
+	{
+		Internal_AddItem(TInstancedStruct<FCrimItem>(Item));
+	}
+}
+
+void UCrimItemContainerBase::Internal_AddItem(TInstancedStruct<FCrimItem>&& Item)
+{
+	if (HasAuthority())
+	{
+		Item.GetMutablePtr<FCrimItem>()->ItemContainer = this;
+		Item.GetMutablePtr<FCrimItem>()->ItemManager = ItemManagerComponent;
+		ItemList.AddItem(MoveTemp(Item));
+	}
+	else if (IsPredicting())
+	{
+		Item.GetMutablePtr<FCrimItem>()->ItemContainer = this;
+		Item.GetMutablePtr<FCrimItem>()->ItemManager = ItemManagerComponent;
+		PendingPredictions.Last().AddedItems.Add(Item.Get<FCrimItem>().GetItemGuid());
+		ItemList.AddPredictedItem(MoveTemp(Item));
+	}
 }
 
 void UCrimItemContainerBase::Internal_RemoveItem(const FGuid& ItemGuid)
 {
 	if (HasAuthority())
 	{
+		if (IsBatching())
+		{
+			PendingRemovedItems.Add(ItemGuid);
+			return;
+		}
 		ItemList.RemoveItem(ItemGuid);
+		ItemList.ConditionalShrink();
+	}
+	else if (IsPredicting())
+	{
+		if (const FFastCrimItem* FastItem = GetItemByGuid(ItemGuid))
+		{
+			// Broadcast before hiding the item, as the removal is suppressed for hidden items.
+			ItemList.OnItemRemovedDelegate.Broadcast(*FastItem);
+			PredictedRemovedItems.Add(ItemGuid);
+			PendingPredictions.Last().RemovedItems.Add(ItemGuid);
+		}
+	}
+}
+
+void UCrimItemContainerBase::BeginPrediction()
+{
+	check(!bIsPredicting);
+	bIsPredicting = true;
+	PendingPredictions.AddDefaulted_GetRef().PredictionKey = ++LastPredictionKey;
+}
+
+int32 UCrimItemContainerBase::EndPrediction()
+{
+	check(bIsPredicting);
+	bIsPredicting = false;
+
+	const FPredictedChange& Prediction = PendingPredictions.Last();
+	if (Prediction.ChangedItems.IsEmpty() && Prediction.AddedItems.IsEmpty() && Prediction.RemovedItems.IsEmpty())
+	{
+		PendingPredictions.Pop(EAllowShrinking::No);
+		return INDEX_NONE;
+	}
+	return Prediction.PredictionKey;
+}
+
+void UCrimItemContainerBase::RecordPredictedChange(const FFastCrimItem& FastItem)
+{
+	if (!bIsPredicting)
+	{
+		return;
+	}
+
+	// Only the value from before the first change is needed. Items added by the prediction are removed instead.
+	FPredictedChange& Prediction = PendingPredictions.Last();
+	const FGuid ItemGuid = FastItem.Item.Get<FCrimItem>().GetItemGuid();
+	if (Prediction.AddedItems.Contains(ItemGuid) ||
+		Prediction.ChangedItems.ContainsByPredicate([&ItemGuid](const TInstancedStruct<FCrimItem>& ChangedItem)
+		{
+			return ChangedItem.Get<FCrimItem>().GetItemGuid() == ItemGuid;
+		}))
+	{
+		return;
+	}
+	Prediction.ChangedItems.Add(FastItem.Item);
+}
+
+void UCrimItemContainerBase::OnPredictionResult(int32 PredictionKey, bool bAccepted)
+{
+	const int32 Index = PendingPredictions.IndexOfByPredicate([PredictionKey](const FPredictedChange& Prediction)
+	{
+		return Prediction.PredictionKey == PredictionKey;
+	});
+	if (Index == INDEX_NONE)
+	{
+		// Already rolled back along with an earlier prediction.
+		return;
+	}
+
+	if (bAccepted)
+	{
+		// The server's copy of the changed and added items replaces the predicted ones as it is received. Items that
+		// were both added and removed by predictions are never received, so they are removed here.
+		for (const FGuid& ItemGuid : PendingPredictions[Index].RemovedItems)
+		{
+			ItemList.RemovePredictedItem(ItemGuid);
+		}
+		PendingPredictions.RemoveAt(Index);
+		return;
+	}
+
+	// The later predictions were made on top of the rejected one, so they are rolled back too. The server still makes
+	// the changes it accepts from them, which are then received like any other change.
+	for (int32 i = PendingPredictions.Num() - 1; i >= Index; i--)
+	{
+		RollbackPrediction(PendingPredictions[i]);
+	}
+	PendingPredictions.SetNum(Index);
+}
+
+void UCrimItemContainerBase::RollbackPrediction(const FPredictedChange& Prediction)
+{
+	// Restored before the removed items are shown again, so they are broadcast with their restored value.
+	for (const TInstancedStruct<FCrimItem>& ChangedItem : Prediction.ChangedItems)
+	{
+		if (FFastCrimItem* FastItem = ItemList.GetItem(ChangedItem.Get<FCrimItem>().GetItemGuid()))
+		{
+			FastItem->Item = ChangedItem;
+			ItemList.RefreshItemIndex(*FastItem);
+			ItemList.OnItemChangedDelegate.Broadcast(*FastItem);
+		}
+	}
+
+	for (const FGuid& ItemGuid : Prediction.RemovedItems)
+	{
+		if (PredictedRemovedItems.Remove(ItemGuid) > 0)
+		{
+			if (const FFastCrimItem* FastItem = ItemList.GetItem(ItemGuid))
+			{
+				ItemList.OnItemAddedDelegate.Broadcast(*FastItem);
+			}
+		}
+	}
+
+	for (const FGuid& ItemGuid : Prediction.AddedItems)
+	{
+		ItemList.RemovePredictedItem(ItemGuid);
 	}
 }
 
@@ -446,13 +911,14 @@ TArray<TInstancedStruct<FCrimItem>> UCrimItemContainerBase::ExecuteAddItemPlan(c
 
 	// Check for a duplicate ItemGuid. The Item being added will retain its original ItemGuid if an existing Guid is not found.
 	bool bFoundDuplicateItemGuid = false;
-	if (GetItemByGuid(Item.Get<FCrimItem>().GetItemGuid()))
+	if (ItemList.GetItem(Item.Get<FCrimItem>().GetItemGuid()))
 	{
 		bFoundDuplicateItemGuid = true;
 	}
 	
 	if (AddItemPlan.IsValid())
 	{
+		FCrimItemBatchScope BatchScope(this);
 		for (const FCrimAddItemPlanEntry& Entry : AddItemPlan.GetEntries())
 		{
 			if (Entry.FastItemPtr)
@@ -487,6 +953,77 @@ TArray<TInstancedStruct<FCrimItem>> UCrimItemContainerBase::ExecuteAddItemPlan(c
 	return Result;
 }
 
+void UCrimItemContainerBase::BeginBatch()
+{
+	++BatchDepth;
+}
+
+void UCrimItemContainerBase::EndBatch()
+{
+	check(BatchDepth > 0);
+	if (--BatchDepth > 0)
+	{
+		return;
+	}
+
+	const TSet<FGuid> AddedItems = MoveTemp(PendingAddedItems);
+	const TSet<FGuid> RemovedItems = MoveTemp(PendingRemovedItems);
+	const TSet<FGuid> DirtyItems = MoveTemp(PendingDirtyItems);
+	FCrimItemContainerChangeset Changeset;
+	Changeset.RemovedItems = MoveTemp(RemovedWhileBatchingItems);
+	Changeset.AddedItems.Reserve(AddedItems.Num());
+
+	for (const FGuid& ItemGuid : RemovedItems)
+	{
+		if (ItemList.RemoveItem(ItemGuid) && !AddedItems.Contains(ItemGuid))
+		{
+			Changeset.RemovedItems.Add(ItemGuid);
+		}
+	}
+	if (RemovedItems.Num() > 0)
+	{
+		ItemList.ConditionalShrink();
+	}
+
+	// Items that were added and removed again in the same batch are left out.
+	for (const FGuid& ItemGuid : AddedItems)
+	{
+		if (!RemovedItems.Contains(ItemGuid))
+		{
+			Changeset.AddedItems.Add(ItemGuid);
+		}
+	}
+
+	for (const FGuid& ItemGuid : DirtyItems)
+	{
+		// The item may have been removed after it was modified.
+		if (FFastCrimItem* FastItem = ItemList.GetItem(ItemGuid))
+		{
+			// The sections were gathered while batching.
+			MarkItemDirty(*FastItem, ECrimItemNetSection::None);
+			if (!AddedItems.Contains(ItemGuid))
+			{
+				Changeset.ChangedItems.Add(ItemGuid);
+			}
+		}
+	}
+
+	if (!Changeset.IsEmpty())
+	{
+		OnItemsChangedDelegate.Broadcast(this, Changeset);
+	}
+}
+
+bool UCrimItemContainerBase::IsPendingRemoval(const FFastCrimItem& FastItem) const
+{
+	if (PendingRemovedItems.Num() == 0 && PredictedRemovedItems.Num() == 0)
+	{
+		return false;
+	}
+	const FGuid ItemGuid = FastItem.Item.Get<FCrimItem>().GetItemGuid();
+	return PendingRemovedItems.Contains(ItemGuid) || PredictedRemovedItems.Contains(ItemGuid);
+}
+
 void UCrimItemContainerBase::BindToItemListDelegates()
 {
 	ItemList.OnItemAddedDelegate.AddUObject(this, &UCrimItemContainerBase::Internal_OnItemAdded);
@@ -496,6 +1033,10 @@ void UCrimItemContainerBase::BindToItemListDelegates()
 
 void UCrimItemContainerBase::Internal_OnItemAdded(const FFastCrimItem& FastItem)
 {
+	if (IsBatching())
+	{
+		PendingAddedItems.Add(FastItem.Item.Get<FCrimItem>().GetItemGuid());
+	}
 	OnItemAdded(FastItem);
 	K2_OnItemAdded(FastItem);
 	OnItemAddedDelegate.Broadcast(this, FastItem);
@@ -503,6 +1044,20 @@ void UCrimItemContainerBase::Internal_OnItemAdded(const FFastCrimItem& FastItem)
 
 void UCrimItemContainerBase::Internal_OnItemRemoved(const FFastCrimItem& FastItem)
 {
+	if (PredictedRemovedItems.Num() > 0 && PredictedRemovedItems.Remove(FastItem.Item.Get<FCrimItem>().GetItemGuid()) > 0)
+	{
+		// The removal was broadcast when it was predicted.
+		return;
+	}
+	if (IsBatching())
+	{
+		// Removed straight from the ItemList while batching, for example by MoveItem.
+		const FGuid& ItemGuid = FastItem.Item.Get<FCrimItem>().GetItemGuid();
+		if (PendingAddedItems.Remove(ItemGuid) == 0)
+		{
+			RemovedWhileBatchingItems.Add(ItemGuid);
+		}
+	}
 	OnItemRemoved(FastItem);
 	K2_OnItemRemoved(FastItem);
 	OnItemRemovedDelegate.Broadcast(this, FastItem);
@@ -510,8 +1065,47 @@ void UCrimItemContainerBase::Internal_OnItemRemoved(const FFastCrimItem& FastIte
 
 void UCrimItemContainerBase::Internal_OnItemChanged(const FFastCrimItem& FastItem)
 {
+	if (PredictedRemovedItems.Num() > 0 && PredictedRemovedItems.Contains(FastItem.Item.Get<FCrimItem>().GetItemGuid()))
+	{
+		return;
+	}
 	OnItemChanged(FastItem);
 	K2_OnItemChanged(FastItem);
 	OnItemChangedDelegate.Broadcast(this, FastItem);
 }
 
+FCrimItemBatchScope::FCrimItemBatchScope(UCrimItemContainerBase* ItemContainer)
+{
+	if (IsValid(ItemContainer) && ItemContainer->HasAuthority())
+	{
+		ItemContainer->BeginBatch();
+		ItemContainers.Add(ItemContainer);
+	}
+}
+
+FCrimItemBatchScope::FCrimItemBatchScope(const UCrimItemManagerComponent* ItemManager)
+{
+	if (IsValid(ItemManager) && ItemManager->HasAuthority())
+	{
+		for (const FFastCrimItemContainerItem& Entry : ItemManager->GetItemContainers())
+		{
+			UCrimItemContainerBase* ItemContainer = Entry.GetItemContainer();
+			if (IsValid(ItemContainer))
+			{
+				ItemContainer->BeginBatch();
+				ItemContainers.Add(ItemContainer);
+			}
+		}
+	}
+}
+
+FCrimItemBatchScope::~FCrimItemBatchScope()
+{
+	for (const TWeakObjectPtr<UCrimItemContainerBase>& ItemContainer : ItemContainers)
+	{
+		if (ItemContainer.IsValid())
+		{
+			ItemContainer->EndBatch();
+		}
+	}
+}
@@ -36,24 +36,14 @@ void ACrimItemDrop::TakeItem(UCrimItemContainerBase* ItemContainer)
 		return;
 	}
 
-	FFastCrimItem* FastItem = ItemDropItemContainer->GetItemByGuid(ItemGuid);
-	if (FastItem == nullptr)
+	if (ItemDropItemContainer->GetItemByGuid(ItemGuid) == nullptr)
 	{
 		return;
 	}
 
-	FCrimItem* Item = FastItem->Item.GetMutablePtr<FCrimItem>();
-
-	FCrimAddItemResult Result = ItemContainer->TryAddItem(FastItem->Item);
-	if (Result.AmountGiven >= 0)
-	{
-		Item->Quantity = Item->Quantity - Result.AmountGiven;
-		ItemDropItemContainer->MarkItemDirty(*FastItem);
-	}
-
-	if (Item->Quantity <= 0)
+	(void)ItemDropItemContainer->MoveItem(ItemGuid, ItemContainer);
+	if (ItemDropItemContainer->GetItemByGuid(ItemGuid) == nullptr)
 	{
-		(void)ItemDropItemContainer->RemoveItem(ItemGuid);
 		OnAllItemsTaken.Broadcast(this);
 	}
 }
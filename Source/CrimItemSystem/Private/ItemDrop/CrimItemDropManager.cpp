@@ -48,14 +48,21 @@ ACrimItemDrop* ACrimItemDropManager::DropItem(const TInstancedStruct<FCrimItem>&
 		return nullptr;
 	}
 
+	UCrimItemContainerBase* SourceContainer = ItemPtr->GetItemContainer();
+	if (!IsValid(SourceContainer))
+	{
+		return nullptr;
+	}
+	const FGuid SourceItemGuid = ItemPtr->GetItemGuid();
+	const int32 Quantity = ItemPtr->Quantity;
+
 	ClearItemDrops();
-	TInstancedStruct<FCrimItem> RemovedItem = ItemPtr->GetItemContainer()->RemoveItem(ItemPtr->GetItemGuid());
-	if (!RemovedItem.IsValid())
+	FCrimAddItemResult Result = SourceContainer->MoveItem(SourceItemGuid, ItemContainer, Quantity);
+	if (Result.Items.Num() == 0)
 	{
 		return nullptr;
 	}
 
-	FCrimAddItemResult Result = ItemContainer->TryAddItem(RemovedItem);
 	FGuid ItemGuid = Result.Items[0].GetPtr<FCrimItem>()->GetItemGuid();
 	return CreateItemDrop(ItemGuid, Params);
 }
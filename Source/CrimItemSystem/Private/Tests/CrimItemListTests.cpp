@@ -0,0 +1,198 @@
+﻿// Copyright Soccertitan
+
+
+#include "CrimItemFastTypes.h"
+
+#include "CrimItemDefinition.h"
+#include "CrimItemSystem.h"
+#include "CrimItemTestHelpers.h"
+#include "ItemContainer/CrimItemContainerBase.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace CrimItemListTests
+{
+	static SIZE_T MeasureItemList(const UCrimItemDefinition* ItemDefinition, int32 NumItems, bool bKeepPreReplicatedItems)
+	{
+		FFastCrimItemList ItemList;
+		ItemList.SetKeepPreReplicatedItems(bKeepPreReplicatedItems);
+		ItemList.Reserve(NumItems);
+		for (int32 i = 0; i < NumItems; i++)
+		{
+			ItemList.AddItem(UCrimItemContainerBase::CreateItem(ItemDefinition));
+		}
+		return ItemList.GetAllocatedSize();
+	}
+
+	/** The lookup FFastCrimItemList::GetItem replaced, kept to compare against. */
+	static const FFastCrimItem* FindItemByScan(const FFastCrimItemList& ItemList, const FGuid& ItemGuid)
+	{
+		for (const FFastCrimItem& FastItem : ItemList.GetItems())
+		{
+			if (FastItem.Item.Get<FCrimItem>().GetItemGuid() == ItemGuid)
+			{
+				return &FastItem;
+			}
+		}
+		return nullptr;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCrimItemListGuidLookupTest, "CrimItemSystem.ItemList.GuidLookup",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCrimItemListGuidLookupTest::RunTest(const FString& Parameters)
+{
+	const UCrimItemDefinition* ItemDefinition = CrimItemTests::CreateItemDefinition();
+	FFastCrimItemList ItemList;
+	const TArray<FGuid> ItemGuids = CrimItemTests::AddItems(ItemList, ItemDefinition, 200);
+
+	// Removing swaps the last item into the removed slot, every other item must still be found.
+	TArray<FGuid> RemovedGuids;
+	for (int32 i = 1; i < ItemGuids.Num(); i += 5)
+	{
+		TestTrue(TEXT("RemoveItem finds the item"), ItemList.RemoveItem(ItemGuids[i]));
+		RemovedGuids.Add(ItemGuids[i]);
+	}
+	TestFalse(TEXT("RemoveItem fails for a removed item"), ItemList.RemoveItem(ItemGuids[1]));
+	TestEqual(TEXT("GetNum after the removals"), ItemList.GetNum(), ItemGuids.Num() - RemovedGuids.Num());
+
+	// Once less than a quarter of the memory is in use, the lookups must survive the shrink as well.
+	for (int32 i = 0; i < ItemGuids.Num(); i++)
+	{
+		if (i % 5 > 1)
+		{
+			ItemList.RemoveItem(ItemGuids[i]);
+			RemovedGuids.Add(ItemGuids[i]);
+		}
+	}
+	const SIZE_T SizeBeforeShrink = ItemList.GetAllocatedSize();
+	ItemList.ConditionalShrink();
+	TestTrue(TEXT("ConditionalShrink frees memory"), ItemList.GetAllocatedSize() < SizeBeforeShrink);
+
+	for (const FGuid& ItemGuid : ItemGuids)
+	{
+		const FFastCrimItem* FastItem = ItemList.GetItem(ItemGuid);
+		if (RemovedGuids.Contains(ItemGuid))
+		{
+			TestNull(TEXT("GetItem of a removed item"), FastItem);
+		}
+		else if (TestNotNull(TEXT("GetItem of a remaining item"), FastItem))
+		{
+			TestTrue(TEXT("GetItem returns the item with the ItemGuid"), FastItem->Item.Get<FCrimItem>().GetItemGuid() == ItemGuid);
+			TestTrue(TEXT("GetItem agrees with a scan"), FastItem == CrimItemListTests::FindItemByScan(ItemList, ItemGuid));
+		}
+	}
+
+	ItemList.Reset();
+	TestNull(TEXT("GetItem after Reset"), ItemList.GetItem(ItemGuids[0]));
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCrimItemListDefinitionLookupTest, "CrimItemSystem.ItemList.DefinitionLookup",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCrimItemListDefinitionLookupTest::RunTest(const FString& Parameters)
+{
+	const UCrimItemDefinition* Apple = CrimItemTests::CreateItemDefinition();
+	const UCrimItemDefinition* Pear = CrimItemTests::CreateItemDefinition();
+	const FCrimItemDefinitionHandle AppleHandle = Apple->GetItemDefinitionHandle();
+	const FCrimItemDefinitionHandle PearHandle = Pear->GetItemDefinitionHandle();
+
+	FFastCrimItemList ItemList;
+	const TArray<FGuid> FullApples = CrimItemTests::AddItems(ItemList, Apple, 4, 10);
+	const TArray<FGuid> Apples = CrimItemTests::AddItems(ItemList, Apple, 3, 5);
+	CrimItemTests::AddItems(ItemList, Pear, 2, 7);
+
+	TestEqual(TEXT("Apple stacks"), ItemList.GetStackCountByDefinition(AppleHandle), 7);
+	TestEqual(TEXT("Apple quantity"), ItemList.GetQuantityByDefinition(AppleHandle), 55);
+	TestEqual(TEXT("Pear stacks"), ItemList.GetStackCountByDefinition(PearHandle), 2);
+	TestEqual(TEXT("Pear quantity"), ItemList.GetQuantityByDefinition(PearHandle), 14);
+	TestEqual(TEXT("GetItemsByDefinition"), ItemList.GetItemsByDefinition(PearHandle).Num(), 2);
+
+	ItemList.RemoveItem(FullApples[0]);
+	FFastCrimItem* ChangedApple = ItemList.GetItem(Apples[0]);
+	ChangedApple->Item.GetMutable<FCrimItem>().Quantity = 10;
+	ItemList.RefreshItemIndex(*ChangedApple);
+	TestEqual(TEXT("Apple stacks after a removal"), ItemList.GetStackCountByDefinition(AppleHandle), 6);
+	TestEqual(TEXT("Apple quantity after a removal and a change"), ItemList.GetQuantityByDefinition(AppleHandle), 50);
+
+	// Only the stacks that are not full yet are visited.
+	int32 NumBelowQuantity = 0;
+	ItemList.ForEachMatchingItemBelowQuantity(UCrimItemContainerBase::CreateItem(Apple), 10, [this, &NumBelowQuantity](FFastCrimItem& FastItem)
+	{
+		TestTrue(TEXT("Visited stack is below the quantity"), FastItem.Item.Get<FCrimItem>().Quantity < 10);
+		NumBelowQuantity++;
+		return true;
+	});
+	TestEqual(TEXT("Apple stacks below the quantity"), NumBelowQuantity, 2);
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCrimItemListLookupBenchmark, "CrimItemSystem.ItemList.LookupBenchmark",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::PerfFilter)
+
+bool FCrimItemListLookupBenchmark::RunTest(const FString& Parameters)
+{
+	const UCrimItemDefinition* ItemDefinition = CrimItemTests::CreateItemDefinition();
+	const FCrimItemDefinitionHandle ItemDefinitionHandle = ItemDefinition->GetItemDefinitionHandle();
+
+	for (const int32 NumItems : {10, 1000, 100000})
+	{
+		FFastCrimItemList ItemList;
+		ItemList.Reserve(NumItems);
+		const TArray<FGuid> ItemGuids = CrimItemTests::AddItems(ItemList, ItemDefinition, NumItems);
+
+		// The scan is quadratic over all the items, so it only looks up a sample of them.
+		const int32 NumLookups = FMath::Min(NumItems, 1000);
+		int32 NumFound = 0;
+
+		double StartTime = FPlatformTime::Seconds();
+		for (int32 i = 0; i < NumLookups; i++)
+		{
+			NumFound += ItemList.GetItem(ItemGuids[i * NumItems / NumLookups]) ? 1 : 0;
+		}
+		const double IndexTime = FPlatformTime::Seconds() - StartTime;
+
+		StartTime = FPlatformTime::Seconds();
+		for (int32 i = 0; i < NumLookups; i++)
+		{
+			NumFound += CrimItemListTests::FindItemByScan(ItemList, ItemGuids[i * NumItems / NumLookups]) ? 1 : 0;
+		}
+		const double ScanTime = FPlatformTime::Seconds() - StartTime;
+
+		StartTime = FPlatformTime::Seconds();
+		int32 Quantity = 0;
+		for (int32 i = 0; i < NumLookups; i++)
+		{
+			Quantity += ItemList.GetQuantityByDefinition(ItemDefinitionHandle);
+		}
+		const double DefinitionTime = FPlatformTime::Seconds() - StartTime;
+
+		TestEqual(TEXT("Every lookup finds its item"), NumFound, NumLookups * 2);
+		TestEqual(TEXT("GetQuantityByDefinition"), Quantity, NumItems * NumLookups);
+		UE_LOG(LogCrimItemSystem, Display, TEXT("%d items: GetItem %.1f ns, scan %.1f ns, GetQuantityByDefinition %.1f ns per lookup."),
+			NumItems, IndexTime * 1e9 / NumLookups, ScanTime * 1e9 / NumLookups, DefinitionTime * 1e9 / NumLookups);
+	}
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCrimItemListPreReplicatedMemoryTest, "CrimItemSystem.ItemList.PreReplicatedItemMemory",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCrimItemListPreReplicatedMemoryTest::RunTest(const FString& Parameters)
+{
+	constexpr int32 NumItems = 100000;
+	const UCrimItemDefinition* ItemDefinition = CrimItemTests::CreateItemDefinition();
+
+	const SIZE_T WithoutCopies = CrimItemListTests::MeasureItemList(ItemDefinition, NumItems, false);
+	const SIZE_T WithCopies = CrimItemListTests::MeasureItemList(ItemDefinition, NumItems, true);
+	UE_LOG(LogCrimItemSystem, Display, TEXT("%d items use %.2f MB without bKeepPreReplicatedItems and %.2f MB with it."),
+		NumItems, WithoutCopies / (1024.0 * 1024.0), WithCopies / (1024.0 * 1024.0));
+
+	TestTrue(TEXT("Keeping the pre replicated items costs memory"), WithCopies > WithoutCopies);
+	return true;
+}
+
+#endif
@@ -0,0 +1,60 @@
+﻿// Copyright Soccertitan
+
+
+#include "CrimItemFastTypes.h"
+
+#include "CrimItemDefinition.h"
+#include "CrimItemTestHelpers.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCrimItemListNetBudgetTest, "CrimItemSystem.ItemList.NetUpdateBudget",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCrimItemListNetBudgetTest::RunTest(const FString& Parameters)
+{
+	const UCrimItemDefinition* ItemDefinition = CrimItemTests::CreateItemDefinition();
+	FFastCrimItemList ItemList;
+	const TArray<FGuid> ItemGuids = CrimItemTests::AddItems(ItemList, ItemDefinition, 20);
+
+	TSet<int32> HeldBackItemIDs;
+	TestEqual(TEXT("Nothing is held back without a budget"), ItemList.SelectHeldBackItems(nullptr, HeldBackItemIDs), 0);
+
+	ItemList.SetMaxNewItemsPerNetUpdate(5);
+	TestEqual(TEXT("A new connection gets the item budget"), ItemList.SelectHeldBackItems(nullptr, HeldBackItemIDs), 15);
+	TestEqual(TEXT("Every held back item is returned"), HeldBackItemIDs.Num(), 15);
+
+	// A prioritized item is sent first, even though it was added before all the others.
+	FFastCrimItem* PrioritizedItem = ItemList.GetItem(ItemGuids[0]);
+	ItemList.PrioritizeItemReplication(*PrioritizedItem);
+	ItemList.SelectHeldBackItems(nullptr, HeldBackItemIDs);
+	TestFalse(TEXT("The prioritized item is not held back"), HeldBackItemIDs.Contains(PrioritizedItem->ReplicationID));
+
+	// The items a connection already has do not count against its budget and are never held back.
+	TMap<int32, int32> BaseReplicationKeys;
+	for (int32 i = 0; i < 12; i++)
+	{
+		const FFastCrimItem* FastItem = ItemList.GetItem(ItemGuids[i]);
+		BaseReplicationKeys.Add(FastItem->ReplicationID, FastItem->ReplicationKey);
+	}
+	TestEqual(TEXT("A connection with some of the items"), ItemList.SelectHeldBackItems(&BaseReplicationKeys, HeldBackItemIDs), 3);
+	for (const TPair<int32, int32>& Pair : BaseReplicationKeys)
+	{
+		TestFalse(TEXT("Items the connection has are not held back"), HeldBackItemIDs.Contains(Pair.Key));
+	}
+
+	// The byte budget always lets the first item through, so a single large item never stalls the connection.
+	const int32 ItemSize = ItemList.GetItem(ItemGuids[1])->GetNetSizeEstimate();
+	TestTrue(TEXT("The net size of an item is estimated"), ItemSize > 0);
+	ItemList.SetMaxNewItemsPerNetUpdate(0);
+	ItemList.SetMaxNewItemBytesPerNetUpdate(1);
+	TestEqual(TEXT("A byte budget smaller than an item"), ItemList.SelectHeldBackItems(nullptr, HeldBackItemIDs), 19);
+	ItemList.SetMaxNewItemBytesPerNetUpdate(ItemSize * 4 + ItemSize / 2);
+	TestEqual(TEXT("A byte budget of four and a half items"), ItemList.SelectHeldBackItems(nullptr, HeldBackItemIDs), 16);
+	ItemList.SetMaxNewItemsPerNetUpdate(2);
+	TestEqual(TEXT("The smaller of both budgets applies"), ItemList.SelectHeldBackItems(nullptr, HeldBackItemIDs), 18);
+	return true;
+}
+
+#endif
@@ -0,0 +1,58 @@
+﻿// Copyright Soccertitan
+
+
+#include "CrimItemFastTypes.h"
+
+#include "CrimItemDefinition.h"
+#include "CrimItemTestHelpers.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCrimItemListPredictedItemsTest, "CrimItemSystem.ItemList.PredictedItems",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCrimItemListPredictedItemsTest::RunTest(const FString& Parameters)
+{
+	const UCrimItemDefinition* ItemDefinition = CrimItemTests::CreateItemDefinition();
+	const FCrimItemDefinitionHandle ItemDefinitionHandle = ItemDefinition->GetItemDefinitionHandle();
+
+	FFastCrimItemList ItemList;
+	CrimItemTests::AddItems(ItemList, ItemDefinition, 3, 5);
+
+	int32 NumAdded = 0;
+	int32 NumRemoved = 0;
+	ItemList.OnItemAddedDelegate.AddLambda([&NumAdded](const FFastCrimItem& FastItem) { NumAdded++; });
+	ItemList.OnItemRemovedDelegate.AddLambda([&NumRemoved](const FFastCrimItem& FastItem) { NumRemoved++; });
+
+	// A split the client predicts before the server confirms it.
+	TInstancedStruct<FCrimItem> PredictedItem = UCrimItemContainerBase::CreateItem(ItemDefinition, 2);
+	const FGuid PredictedGuid = PredictedItem.Get<FCrimItem>().GetItemGuid();
+	const uint32 VersionBeforePrediction = ItemList.GetVersion();
+	ItemList.AddPredictedItem(MoveTemp(PredictedItem));
+
+	TestEqual(TEXT("The predicted item is broadcast as added"), NumAdded, 1);
+	TestTrue(TEXT("Predicting changes the version"), ItemList.GetVersion() != VersionBeforePrediction);
+	TestTrue(TEXT("HasPredictedItem"), ItemList.HasPredictedItem(PredictedGuid));
+	TestEqual(TEXT("The predicted item is kept out of the replicated items"), ItemList.GetItems().Num(), 3);
+
+	const FFastCrimItem* FastItem = ItemList.GetItem(PredictedGuid);
+	if (TestNotNull(TEXT("GetItem finds the predicted item"), FastItem))
+	{
+		TestEqual(TEXT("The predicted item has no ReplicationID"), FastItem->ReplicationID, INDEX_NONE);
+	}
+	TestEqual(TEXT("The stack count includes the predicted item"), ItemList.GetStackCountByDefinition(ItemDefinitionHandle), 4);
+	TestEqual(TEXT("The quantity includes the predicted item"), ItemList.GetQuantityByDefinition(ItemDefinitionHandle), 17);
+	TestEqual(TEXT("FindMatchingItems includes the predicted item"),
+		ItemList.FindMatchingItems(UCrimItemContainerBase::CreateItem(ItemDefinition)).Num(), 4);
+
+	// The server rejected the prediction.
+	TestTrue(TEXT("RemovePredictedItem"), ItemList.RemovePredictedItem(PredictedGuid));
+	TestFalse(TEXT("RemovePredictedItem of a removed item"), ItemList.RemovePredictedItem(PredictedGuid));
+	TestEqual(TEXT("The rolled back item is broadcast as removed"), NumRemoved, 1);
+	TestNull(TEXT("GetItem after the rollback"), ItemList.GetItem(PredictedGuid));
+	TestEqual(TEXT("The quantity after the rollback"), ItemList.GetQuantityByDefinition(ItemDefinitionHandle), 15);
+	return true;
+}
+
+#endif
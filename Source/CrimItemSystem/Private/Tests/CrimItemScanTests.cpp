@@ -0,0 +1,64 @@
+﻿// Copyright Soccertitan
+
+
+#include "CrimItemFastTypes.h"
+
+#include "CrimItemDefinition.h"
+#include "CrimItemSystem.h"
+#include "CrimItemTestHelpers.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCrimItemListScanBenchmark, "CrimItemSystem.ItemList.ScanBenchmark",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::PerfFilter)
+
+bool FCrimItemListScanBenchmark::RunTest(const FString& Parameters)
+{
+	constexpr int32 MaxQuantity = 10;
+	constexpr int32 NumScans = 20;
+	const UCrimItemDefinition* ItemDefinition = CrimItemTests::CreateItemDefinition();
+	const TInstancedStruct<FCrimItem> TestItem = UCrimItemContainerBase::CreateItem(ItemDefinition);
+
+	for (const int32 NumItems : {1000, 10000, 100000})
+	{
+		// Every stack of the same item, with one in a hundred not full yet, like a large stash being added to.
+		FFastCrimItemList ItemList;
+		ItemList.Reserve(NumItems);
+		CrimItemTests::AddItems(ItemList, ItemDefinition, NumItems - NumItems / 100, MaxQuantity);
+		CrimItemTests::AddItems(ItemList, ItemDefinition, NumItems / 100, MaxQuantity / 2);
+
+		int32 NumColumnMatches = 0;
+		double StartTime = FPlatformTime::Seconds();
+		for (int32 Scan = 0; Scan < NumScans; Scan++)
+		{
+			ItemList.ForEachMatchingItemBelowQuantity(TestItem, MaxQuantity, [&NumColumnMatches](FFastCrimItem& FastItem)
+			{
+				NumColumnMatches++;
+				return true;
+			});
+		}
+		const double ColumnTime = FPlatformTime::Seconds() - StartTime;
+
+		// What planning an add did before the hot columns, reading every matching item to check its quantity.
+		int32 NumItemMatches = 0;
+		StartTime = FPlatformTime::Seconds();
+		for (int32 Scan = 0; Scan < NumScans; Scan++)
+		{
+			ItemList.ForEachMatchingItem(TestItem, [&NumItemMatches](FFastCrimItem& FastItem)
+			{
+				NumItemMatches += FastItem.Item.Get<FCrimItem>().Quantity < MaxQuantity ? 1 : 0;
+				return true;
+			});
+		}
+		const double ItemTime = FPlatformTime::Seconds() - StartTime;
+
+		TestEqual(TEXT("Both scans find the same stacks"), NumColumnMatches, NumItemMatches);
+		TestEqual(TEXT("Stacks below the quantity"), NumColumnMatches, NumItems / 100 * NumScans);
+		UE_LOG(LogCrimItemSystem, Display, TEXT("%d items: quantity column %.2f M items/s, reading the items %.2f M items/s."),
+			NumItems, NumItems * NumScans / ColumnTime * 1e-6, NumItems * NumScans / ItemTime * 1e-6);
+	}
+	return true;
+}
+
+#endif
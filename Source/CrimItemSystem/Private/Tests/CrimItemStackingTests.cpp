@@ -0,0 +1,49 @@
+﻿// Copyright Soccertitan
+
+
+#include "CrimItemFastTypes.h"
+
+#include "CrimItemDefinition.h"
+#include "CrimItemTestHelpers.h"
+#include "CrimItemTestTypes.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCrimItemListStackSignatureTest, "CrimItemSystem.ItemList.StackSignature",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCrimItemListStackSignatureTest::RunTest(const FString& Parameters)
+{
+	const UCrimItemDefinition* Apple = CrimItemTests::CreateItemDefinition();
+	const UCrimItemDefinition* Pear = CrimItemTests::CreateItemDefinition();
+
+	FFastCrimItemList ItemList;
+	CrimItemTests::AddItems(ItemList, Apple, 3, 5);
+	CrimItemTests::AddItems(ItemList, Pear, 2, 5);
+
+	const TInstancedStruct<FCrimItem> TestApple = UCrimItemContainerBase::CreateItem(Apple);
+	TestEqual(TEXT("Items of another ItemDefinition have another signature"), ItemList.FindMatchingItems(TestApple).Num(), 3);
+	TestTrue(TEXT("Matching items share the stack signature"),
+		TestApple.Get<FCrimItem>().GetStackSignature() == ItemList.FindMatchingItem(TestApple)->Item.Get<FCrimItem>().GetStackSignature());
+
+	// IsMatching accepts both ItemDefinitions here, which the signature buckets would never find.
+	const UCrimItemDefinition* Coin = CrimItemTests::CreateItemDefinition(FCrimItemTest_StacksWithAnyDefinition::StaticStruct());
+	const UCrimItemDefinition* Gem = CrimItemTests::CreateItemDefinition(FCrimItemTest_StacksWithAnyDefinition::StaticStruct());
+	CrimItemTests::AddItems(ItemList, Coin, 2, 5);
+	CrimItemTests::AddItems(ItemList, Gem, 2, 10);
+
+	const TInstancedStruct<FCrimItem> TestCoin = UCrimItemContainerBase::CreateItem(Coin);
+	TestEqual(TEXT("UsesStackSignature false checks every item"), ItemList.FindMatchingItems(TestCoin).Num(), 4);
+
+	int32 NumBelowQuantity = 0;
+	ItemList.ForEachMatchingItemBelowQuantity(TestCoin, 10, [&NumBelowQuantity](FFastCrimItem& FastItem)
+	{
+		NumBelowQuantity++;
+		return true;
+	});
+	TestEqual(TEXT("UsesStackSignature false still skips full stacks"), NumBelowQuantity, 2);
+	return true;
+}
+
+#endif
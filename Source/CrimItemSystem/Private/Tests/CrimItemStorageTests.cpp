@@ -0,0 +1,91 @@
+﻿// Copyright Soccertitan
+
+
+#include "CrimItemFastTypes.h"
+
+#include "CrimItemDefinition.h"
+#include "CrimItemSystem.h"
+#include "CrimItemTestHelpers.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCrimItemListShrinkTest, "CrimItemSystem.ItemList.MinShrinkCapacity",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCrimItemListShrinkTest::RunTest(const FString& Parameters)
+{
+	const UCrimItemDefinition* ItemDefinition = CrimItemTests::CreateItemDefinition();
+
+	for (const int32 MinShrinkCapacity : {0, 64, 1024})
+	{
+		FFastCrimItemList ItemList;
+		ItemList.SetMinShrinkCapacity(MinShrinkCapacity);
+		const TArray<FGuid> ItemGuids = CrimItemTests::AddItems(ItemList, ItemDefinition, 200);
+		for (int32 i = 10; i < ItemGuids.Num(); i++)
+		{
+			ItemList.RemoveItem(ItemGuids[i]);
+		}
+
+		const SIZE_T SizeBeforeShrink = ItemList.GetAllocatedSize();
+		ItemList.ConditionalShrink();
+		const bool bExpectShrink = MinShrinkCapacity < 200;
+		TestEqual(FString::Printf(TEXT("ConditionalShrink with a MinShrinkCapacity of %d"), MinShrinkCapacity),
+			ItemList.GetAllocatedSize() < SizeBeforeShrink, bExpectShrink);
+		TestNotNull(TEXT("The remaining items are found after ConditionalShrink"), ItemList.GetItem(ItemGuids[0]));
+	}
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCrimItemListStorageBenchmark, "CrimItemSystem.ItemList.StorageBenchmark",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::PerfFilter)
+
+bool FCrimItemListStorageBenchmark::RunTest(const FString& Parameters)
+{
+	const UCrimItemDefinition* ItemDefinition = CrimItemTests::CreateItemDefinition();
+
+	for (const int32 NumItems : {1000, 10000, 100000})
+	{
+		// The items are created up front, so only the allocations of the list itself are counted.
+		TArray<TInstancedStruct<FCrimItem>> NewItems;
+		NewItems.Reserve(NumItems);
+		for (int32 i = 0; i < NumItems; i++)
+		{
+			NewItems.Add(UCrimItemContainerBase::CreateItem(ItemDefinition));
+		}
+
+		for (const bool bReserve : {false, true})
+		{
+			FFastCrimItemList ItemList;
+			const int32 NumAllocations = CrimItemTests::CountAllocations([&ItemList, &NewItems, bReserve]()
+			{
+				if (bReserve)
+				{
+					ItemList.Reserve(NewItems.Num());
+				}
+				for (const TInstancedStruct<FCrimItem>& Item : NewItems)
+				{
+					ItemList.AddItem(Item);
+				}
+			});
+			const SIZE_T FilledSize = ItemList.GetAllocatedSize();
+
+			// Remove all but a tenth of the items, then free the unused memory.
+			for (int32 i = NumItems / 10; i < NumItems; i++)
+			{
+				ItemList.RemoveItem(NewItems[i].Get<FCrimItem>().GetItemGuid());
+			}
+			const SIZE_T DrainedSize = ItemList.GetAllocatedSize();
+			ItemList.ConditionalShrink();
+			const SIZE_T ShrunkSize = ItemList.GetAllocatedSize();
+
+			TestTrue(TEXT("ConditionalShrink frees the unused memory"), ShrunkSize < DrainedSize);
+			UE_LOG(LogCrimItemSystem, Display, TEXT("%d items%s: %.1f allocations per item, %.2f MB filled, %.2f MB after removing 90%%, %.2f MB after ConditionalShrink."),
+				NumItems, bReserve ? TEXT(" with Reserve") : TEXT(""), double(NumAllocations) / NumItems,
+				FilledSize / (1024.0 * 1024.0), DrainedSize / (1024.0 * 1024.0), ShrunkSize / (1024.0 * 1024.0));
+		}
+	}
+	return true;
+}
+
+#endif
@@ -0,0 +1,119 @@
+﻿// Copyright Soccertitan
+
+#pragma once
+
+#include "CrimItemDefinition.h"
+#include "CrimItemFastTypes.h"
+#include "HAL/MemoryBase.h"
+#include "HAL/PlatformTLS.h"
+#include "ItemContainer/CrimItemContainerBase.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace CrimItemTests
+{
+	inline UCrimItemDefinition* CreateItemDefinition(const UScriptStruct* ItemClass = FCrimItem::StaticStruct())
+	{
+		UCrimItemDefinition* ItemDefinition = NewObject<UCrimItemDefinition>(GetTransientPackage(), NAME_None, RF_Transient);
+		ItemDefinition->ItemClass.InitializeAsScriptStruct(ItemClass);
+		return ItemDefinition;
+	}
+
+	/** Adds NumItems new items of the ItemDefinition to the ItemList and returns their ItemGuids. */
+	inline TArray<FGuid> AddItems(FFastCrimItemList& ItemList, const UCrimItemDefinition* ItemDefinition, int32 NumItems, int32 Quantity = 1)
+	{
+		TArray<FGuid> Result;
+		Result.Reserve(NumItems);
+		for (int32 i = 0; i < NumItems; i++)
+		{
+			TInstancedStruct<FCrimItem> Item = UCrimItemContainerBase::CreateItem(ItemDefinition, Quantity);
+			Result.Add(Item.Get<FCrimItem>().GetItemGuid());
+			ItemList.AddItem(MoveTemp(Item));
+		}
+		return Result;
+	}
+
+	/** Forwards to the previous GMalloc and counts the allocations made on the thread that installed it. */
+	class FCountingMalloc final : public FMalloc
+	{
+	public:
+		void Install()
+		{
+			check(GMalloc != this);
+			Inner = GMalloc;
+			ThreadId = FPlatformTLS::GetCurrentThreadId();
+			NumAllocations = 0;
+			GMalloc = this;
+		}
+
+		void Uninstall()
+		{
+			check(GMalloc == this);
+			GMalloc = Inner;
+			// Other threads may still be inside this proxy, so Inner stays valid and it keeps forwarding.
+			ThreadId = 0;
+		}
+
+		int32 GetNumAllocations() const { return NumAllocations; }
+
+		virtual void* Malloc(SIZE_T Count, uint32 Alignment) override
+		{
+			CountAllocation();
+			return Inner->Malloc(Count, Alignment);
+		}
+
+		virtual void* TryMalloc(SIZE_T Count, uint32 Alignment) override
+		{
+			CountAllocation();
+			return Inner->TryMalloc(Count, Alignment);
+		}
+
+		virtual void* Realloc(void* Original, SIZE_T Count, uint32 Alignment) override
+		{
+			CountAllocation();
+			return Inner->Realloc(Original, Count, Alignment);
+		}
+
+		virtual void* TryRealloc(void* Original, SIZE_T Count, uint32 Alignment) override
+		{
+			CountAllocation();
+			return Inner->TryRealloc(Original, Count, Alignment);
+		}
+
+		virtual void Free(void* Original) override { Inner->Free(Original); }
+		virtual SIZE_T QuantizeSize(SIZE_T Count, uint32 Alignment) override { return Inner->QuantizeSize(Count, Alignment); }
+		virtual bool GetAllocationSize(void* Original, SIZE_T& SizeOut) override { return Inner->GetAllocationSize(Original, SizeOut); }
+		virtual void Trim(bool bTrimThreadCaches) override { Inner->Trim(bTrimThreadCaches); }
+		virtual void SetupTLSCachesOnCurrentThread() override { Inner->SetupTLSCachesOnCurrentThread(); }
+		virtual void ClearAndDisableTLSCachesOnCurrentThread() override { Inner->ClearAndDisableTLSCachesOnCurrentThread(); }
+		virtual bool IsInternallyThreadSafe() const override { return Inner->IsInternallyThreadSafe(); }
+		virtual bool ValidateHeap() override { return Inner->ValidateHeap(); }
+		virtual const TCHAR* GetDescriptiveName() override { return TEXT("CrimItemCountingMalloc"); }
+
+	private:
+		void CountAllocation()
+		{
+			if (FPlatformTLS::GetCurrentThreadId() == ThreadId)
+			{
+				NumAllocations++;
+			}
+		}
+
+		FMalloc* Inner = nullptr;
+		uint32 ThreadId = 0;
+		int32 NumAllocations = 0;
+	};
+
+	/** Returns the number of allocations Func makes on this thread. */
+	inline int32 CountAllocations(TFunctionRef<void()> Func)
+	{
+		// Never destroyed, other threads may still call into it after it is uninstalled.
+		static FCountingMalloc* CountingMalloc = new FCountingMalloc();
+		CountingMalloc->Install();
+		Func();
+		CountingMalloc->Uninstall();
+		return CountingMalloc->GetNumAllocations();
+	}
+}
+
+#endif
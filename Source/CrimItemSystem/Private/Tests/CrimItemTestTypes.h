@@ -0,0 +1,25 @@
+﻿// Copyright Soccertitan
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "CrimItem.h"
+
+#include "CrimItemTestTypes.generated.h"
+
+/**
+ * Item used by the automation tests that stacks with every item of its type, whatever the ItemDefinition. Overrides
+ * IsMatching without GetStackSignature, so it opts out of the stack signature.
+ */
+USTRUCT()
+struct FCrimItemTest_StacksWithAnyDefinition : public FCrimItem
+{
+	GENERATED_BODY()
+
+	virtual bool IsMatching(const TInstancedStruct<FCrimItem>& TestItem) const override
+	{
+		return TestItem.GetScriptStruct() == FCrimItemTest_StacksWithAnyDefinition::StaticStruct();
+	}
+
+	virtual bool UsesStackSignature() const override { return false; }
+};
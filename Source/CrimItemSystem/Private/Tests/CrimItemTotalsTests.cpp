@@ -0,0 +1,100 @@
+﻿// Copyright Soccertitan
+
+
+#include "CrimItemFastTypes.h"
+
+#include "CrimItemDefinition.h"
+#include "CrimItemTestHelpers.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace CrimItemTotalsTests
+{
+	/** Enables CrimItemSystem.ValidateItemIndex for its lifetime, so every change is checked against a full recount. */
+	struct FScopedItemIndexValidation
+	{
+		FScopedItemIndexValidation()
+		{
+			CVar = IConsoleManager::Get().FindConsoleVariable(TEXT("CrimItemSystem.ValidateItemIndex"));
+			if (CVar)
+			{
+				bPreviousValue = CVar->GetBool();
+				CVar->Set(true, ECVF_SetByCode);
+			}
+		}
+
+		~FScopedItemIndexValidation()
+		{
+			if (CVar)
+			{
+				CVar->Set(bPreviousValue, ECVF_SetByCode);
+			}
+		}
+
+		IConsoleVariable* CVar = nullptr;
+		bool bPreviousValue = false;
+	};
+
+	/** The totals GetStackCountByDefinition and GetQuantityByDefinition replaced, kept to compare against. */
+	static void CountByScan(const FFastCrimItemList& ItemList, FCrimItemDefinitionHandle ItemDefinition, int32& OutStackCount, int32& OutQuantity)
+	{
+		OutStackCount = 0;
+		OutQuantity = 0;
+		for (const FFastCrimItem& FastItem : ItemList.GetItems())
+		{
+			const FCrimItem& Item = FastItem.Item.Get<FCrimItem>();
+			if (Item.GetItemDefinitionHandle() == ItemDefinition)
+			{
+				OutStackCount++;
+				OutQuantity += Item.Quantity;
+			}
+		}
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCrimItemListTotalsTest, "CrimItemSystem.ItemList.DefinitionTotals",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCrimItemListTotalsTest::RunTest(const FString& Parameters)
+{
+	CrimItemTotalsTests::FScopedItemIndexValidation ScopedValidation;
+	TestNotNull(TEXT("CrimItemSystem.ValidateItemIndex is registered"), ScopedValidation.CVar);
+
+	const UCrimItemDefinition* Apple = CrimItemTests::CreateItemDefinition();
+	const UCrimItemDefinition* Pear = CrimItemTests::CreateItemDefinition();
+	const TArray<FCrimItemDefinitionHandle> Definitions = {Apple->GetItemDefinitionHandle(), Pear->GetItemDefinitionHandle()};
+
+	FFastCrimItemList ItemList;
+	const TArray<FGuid> Apples = CrimItemTests::AddItems(ItemList, Apple, 50, 3);
+	const TArray<FGuid> Pears = CrimItemTests::AddItems(ItemList, Pear, 20, 7);
+
+	// Mix removals and quantity changes, which move items around and update the totals in place.
+	for (int32 i = 0; i < Apples.Num(); i += 3)
+	{
+		ItemList.RemoveItem(Apples[i]);
+	}
+	for (int32 i = 0; i < Pears.Num(); i += 2)
+	{
+		FFastCrimItem* FastItem = ItemList.GetItem(Pears[i]);
+		FastItem->Item.GetMutable<FCrimItem>().Quantity = i + 1;
+		ItemList.RefreshItemIndex(*FastItem);
+	}
+	ItemList.ConditionalShrink();
+
+	for (const FCrimItemDefinitionHandle& Definition : Definitions)
+	{
+		int32 StackCount = 0;
+		int32 Quantity = 0;
+		CrimItemTotalsTests::CountByScan(ItemList, Definition, StackCount, Quantity);
+		TestEqual(TEXT("GetStackCountByDefinition matches a recount"), ItemList.GetStackCountByDefinition(Definition), StackCount);
+		TestEqual(TEXT("GetQuantityByDefinition matches a recount"), ItemList.GetQuantityByDefinition(Definition), Quantity);
+	}
+
+	ItemList.Reset();
+	TestEqual(TEXT("GetQuantityByDefinition after Reset"), ItemList.GetQuantityByDefinition(Definitions[0]), 0);
+	return true;
+}
+
+#endif
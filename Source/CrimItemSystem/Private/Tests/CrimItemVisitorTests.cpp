@@ -0,0 +1,67 @@
+﻿// Copyright Soccertitan
+
+
+#include "CrimItemFastTypes.h"
+
+#include "CrimItemDefinition.h"
+#include "CrimItemTestHelpers.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCrimItemListVisitorAllocationTest, "CrimItemSystem.ItemList.VisitorAllocations",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCrimItemListVisitorAllocationTest::RunTest(const FString& Parameters)
+{
+	const UCrimItemDefinition* Apple = CrimItemTests::CreateItemDefinition();
+	const UCrimItemDefinition* Pear = CrimItemTests::CreateItemDefinition();
+	const FCrimItemDefinitionHandle AppleHandle = Apple->GetItemDefinitionHandle();
+
+	FFastCrimItemList ItemList;
+	CrimItemTests::AddItems(ItemList, Apple, 10, 5);
+	CrimItemTests::AddItems(ItemList, Pear, 1000);
+	const TInstancedStruct<FCrimItem> TestApple = UCrimItemContainerBase::CreateItem(Apple);
+
+	// Build the lookups up front, the first query after a change may rebuild them.
+	ItemList.GetQuantityByDefinition(AppleHandle);
+
+	int32 NumVisited = 0;
+	const int32 VisitorAllocations = CrimItemTests::CountAllocations([&ItemList, &TestApple, AppleHandle, &NumVisited]()
+	{
+		ItemList.ForEachItem([&NumVisited](FFastCrimItem& FastItem)
+		{
+			NumVisited++;
+			return true;
+		});
+		ItemList.ForEachItemByDefinition(AppleHandle, [&NumVisited](FFastCrimItem& FastItem)
+		{
+			NumVisited++;
+			return true;
+		});
+		// Small signature buckets are copied to the stack before visiting them.
+		ItemList.ForEachMatchingItem(TestApple, [&NumVisited](FFastCrimItem& FastItem)
+		{
+			NumVisited++;
+			return true;
+		});
+		ItemList.ForEachMatchingItemBelowQuantity(TestApple, 10, [&NumVisited](FFastCrimItem& FastItem)
+		{
+			NumVisited++;
+			return true;
+		});
+	});
+	TestEqual(TEXT("Every visitor runs"), NumVisited, 1010 + 10 + 10 + 10);
+	TestEqual(TEXT("The visitors do not allocate"), VisitorAllocations, 0);
+
+	int32 NumItems = 0;
+	const int32 GetterAllocations = CrimItemTests::CountAllocations([&ItemList, AppleHandle, &NumItems]()
+	{
+		NumItems = ItemList.GetItemsByDefinition(AppleHandle).Num();
+	});
+	TestEqual(TEXT("GetItemsByDefinition"), NumItems, 10);
+	TestTrue(TEXT("The allocations are counted"), GetterAllocations > 0);
+	return true;
+}
+
+#endif
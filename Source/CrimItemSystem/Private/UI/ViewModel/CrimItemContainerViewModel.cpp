@@ -41,11 +41,13 @@ void UCrimItemContainerViewModel::OnItemContainerSet()
 		"ViewModel in %s"), *GetItemContainer()->GetName());
 
 	ItemViewModels.Empty();
-	for (const FFastCrimItem& FastItem : GetItemContainer()->GetItems())
+	// Includes the items a client predicted, and skips those it predicted to be removed.
+	GetItemContainer()->ForEachItem([this](const FFastCrimItem& FastItem)
 	{
 		UCrimItemViewModelBase* NewVM = CreateItemViewModel(FastItem.Item);
 		ItemViewModels.Add(NewVM);
-	}
+		return true;
+	});
 
 	UE_MVVM_BROADCAST_FIELD_VALUE_CHANGED(GetMaxCapacity);
 	UE_MVVM_BROADCAST_FIELD_VALUE_CHANGED(GetItemContainerName);
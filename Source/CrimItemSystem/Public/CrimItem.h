@@ -22,6 +22,44 @@ struct CRIMITEMSYSTEM_API FCrimItemFragment
 	virtual ~FCrimItemFragment() {}
 
 	virtual bool IsMatching(const TInstancedStruct<FCrimItemFragment>& Fragment) const {return true;}
+
+	/**
+	 * Returns a hash of the state compared in IsMatching. Two matching fragments must return the same hash. Used to
+	 * bucket items by their stack signature, the default keeps all fragments of the same type in the same bucket.
+	 */
+	virtual uint64 GetMatchingHash() const {return 0;}
+
+	/**
+	 * Return true if the values the ItemDefinition gives this fragment, see FCrimItemDefinitionFragment::SetDefaultValues,
+	 * are the same on every machine. A fragment that still holds them is then replicated as a single bit and rebuilt
+	 * from the ItemDefinition on the receiving side, otherwise it is always sent in full.
+	 */
+	virtual bool CanReplicateAsDefault() const {return false;}
+};
+
+/**
+ * Entry in an item's fragment lookup table. Not serialized, rebuilt from FCrimItem::Fragments.
+ */
+struct FCrimItemFragmentLookup
+{
+	/** The fragment struct, or one of its parent structs. */
+	const UScriptStruct* Struct = nullptr;
+	/** Index of the first fragment that is exactly Struct. */
+	int32 ExactIndex = INDEX_NONE;
+	/** Index of the first fragment that is Struct or a child of it. */
+	int32 FirstIndex = INDEX_NONE;
+};
+
+/**
+ * An item's fragment lookup table. Built once the fragments change and shared by the copies of the item, so copying an
+ * item only copies a pointer to it.
+ */
+struct FCrimItemFragmentLookupTable
+{
+	/** The fragment types of the item and their parents, sorted by struct. */
+	TArray<FCrimItemFragmentLookup> Entries;
+	/** The number of fragments the table was built from. */
+	int32 NumFragments = 0;
 };
 
 /**
@@ -37,6 +75,8 @@ struct CRIMITEMSYSTEM_API FCrimItem
 
 	FGuid GetItemGuid() const { return ItemGuid; }
 	TSoftObjectPtr<UCrimItemDefinition> GetItemDefinition() const { return ItemDefinition; }
+	/** Returns the registry handle of the ItemDefinition. See UCrimItemDefinitionRegistry. */
+	FCrimItemDefinitionHandle GetItemDefinitionHandle() const;
 
 	/** The quantity of this item instance. */
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, SaveGame)
@@ -46,13 +86,31 @@ struct CRIMITEMSYSTEM_API FCrimItem
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, SaveGame)
 	FCrimItemTagStackContainer TagStats;
 
-	/** Extends an item's capabilities. */
+	/**
+	 * Extends an item's capabilities.
+	 * @note Use SetFragment or AddFragment to change the fragments, or call RefreshCachedState after replacing one in
+	 * place, so the fragment lookup table is rebuilt.
+	 */
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, SaveGame, meta = (FullyExpand=true, StructTypeConst), EditFixedSize)
 	TArray<TInstancedStruct<FCrimItemFragment>> Fragments;
 
 	/** Returns true if this Item has the same ItemDefinition, TagStats, and ItemExtensions as the TestItem. */
 	virtual bool IsMatching(const TInstancedStruct<FCrimItem>& TestItem) const;
 
+	/**
+	 * Returns a hash built from the ItemDefinition, TagStats and Fragments. Matching items always share a signature,
+	 * so it is used to narrow down candidates before calling IsMatching. Override this when overriding IsMatching.
+	 */
+	virtual uint64 GetStackSignature() const;
+
+	/**
+	 * Returns false if GetStackSignature can't be used to narrow down the items that IsMatching accepts, which makes
+	 * the matching queries check every item instead. Return false when overriding IsMatching with rules that
+	 * GetStackSignature does not follow. With CrimItemSystem.ValidateItemIndex enabled, a matching item with another
+	 * signature fails an ensure.
+	 */
+	virtual bool UsesStackSignature() const { return true; }
+
 	UCrimItemManagerComponent* GetItemManager() const;
 	UCrimItemContainerBase* GetItemContainer() const;
 
@@ -60,6 +118,39 @@ struct CRIMITEMSYSTEM_API FCrimItem
 	const T* GetFragmentByType() const;
 	template<typename T> requires std::derived_from<T, FCrimItemFragment>
 	T* GetMutableFragmentByType();
+
+	/** Returns the first fragment that is the FragmentType or a child of it. */
+	const TInstancedStruct<FCrimItemFragment>* FindFragment(const UScriptStruct* FragmentType) const;
+
+	/** Replaces the fragment at Index, which may be of another type. */
+	void SetFragment(int32 Index, const TInstancedStruct<FCrimItemFragment>& Fragment);
+
+	/** Adds a fragment to the item. */
+	void AddFragment(const TInstancedStruct<FCrimItemFragment>& Fragment);
+
+	/**
+	 * Rebuilds transient state derived from the serialized properties, such as the fragment lookup table. Called after
+	 * the item is created, loaded or replicated.
+	 */
+	virtual void RefreshCachedState();
+
+	/** Returns the heap memory used by this item, not including the size of the item struct itself. */
+	virtual SIZE_T GetAllocatedSize() const;
+
+	/**
+	 * Serializes the item for replication. A loaded ItemDefinition is sent as a net reference, Quantity and TagStats
+	 * are packed, and fragments equal to the ItemDefinition's defaults are sent as a single bit if their type allows
+	 * it, see FCrimItemFragment::CanReplicateAsDefault.
+	 * Replicated properties added by child structs are sent afterwards by FFastCrimItem with their generic property
+	 * serializer. To pack them as well, mark them NotReplicated and serialize them in an override of this function.
+	 */
+	virtual bool NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess);
+
+	/**
+	 * Serializes only the Sections of the item for replication. The receiving item must already hold every other
+	 * section, so this is only used when the receiver's previous state is known. See FFastCrimItem::NetSerialize.
+	 */
+	bool NetSerializeSections(FArchive& Ar, UPackageMap* Map, ECrimItemNetSection Sections, bool& bOutSuccess);
 	
 protected:
 	/** Called when the ItemContainer creates a new item. */
@@ -75,6 +166,9 @@ private:
 	UPROPERTY(BlueprintReadOnly, meta = (AllowPrivateAccess = true), SaveGame)
 	TSoftObjectPtr<UCrimItemDefinition> ItemDefinition;
 	
+	/** The handle of the ItemDefinition. Resolved lazily, and again every time the cached state is refreshed. */
+	mutable FCrimItemDefinitionHandle ItemDefinitionHandle;
+
 	/** The ItemManager that owns this item. */
 	UPROPERTY(BlueprintReadOnly, Transient, meta = (AllowPrivateAccess = true))
 	TWeakObjectPtr<UCrimItemManagerComponent> ItemManager;
@@ -85,12 +179,25 @@ private:
 
 	friend UCrimItemManagerComponent;
 	friend UCrimItemContainerBase;
+	friend struct FFastCrimItem;
 
 	/**
 	 * Iterates through ThisItem and TestItem extensions. And calls IsMatching on each one.
 	 */
 	bool AreFragmentsEqual(const TInstancedStruct<FCrimItem>& TestItem) const;
 	const FCrimItemFragment* GetFragmentByScriptStruct(const UScriptStruct* Struct) const;
+
+	/**
+	 * Returns the index of the first fragment of the Struct, or INDEX_NONE.
+	 * @param bExactMatch If false, fragments that are a child of the Struct are included.
+	 */
+	int32 FindFragmentIndex(const UScriptStruct* Struct, bool bExactMatch) const;
+	void BuildFragmentLookup() const;
+	/** Returns the FragmentLookup, building it if the fragments changed since it was built. */
+	const FCrimItemFragmentLookupTable& GetFragmentLookup() const;
+
+	/** Cleared whenever the Fragments change, and built on the next lookup. */
+	mutable TSharedPtr<const FCrimItemFragmentLookupTable> FragmentLookup;
 };
 
 /**
@@ -99,14 +206,8 @@ private:
 template <typename T> requires std::derived_from<T, FCrimItemFragment>
 const T* FCrimItem::GetFragmentByType() const
 {
-	for (const TInstancedStruct<FCrimItemFragment>& Fragment : Fragments)
-	{
-		if (const T* Ptr = Fragment.GetPtr<T>())
-		{
-			return Ptr;
-		}
-	}
-	return nullptr;
+	const int32 Index = FindFragmentIndex(T::StaticStruct(), false);
+	return Index != INDEX_NONE ? Fragments[Index].GetPtr<T>() : nullptr;
 }
 
 /**
@@ -115,12 +216,6 @@ const T* FCrimItem::GetFragmentByType() const
 template <typename T> requires std::derived_from<T, FCrimItemFragment>
 T* FCrimItem::GetMutableFragmentByType()
 {
-	for (TInstancedStruct<FCrimItemFragment>& Fragment : Fragments)
-	{
-		if (T* Ptr = Fragment.GetMutablePtr<T>())
-		{
-			return Ptr;
-		}
-	}
-	return nullptr;
+	const int32 Index = FindFragmentIndex(T::StaticStruct(), false);
+	return Index != INDEX_NONE ? Fragments[Index].GetMutablePtr<T>() : nullptr;
 }
@@ -56,6 +56,10 @@ public:
 	UCrimItemDefinition();
 	virtual FPrimaryAssetId GetPrimaryAssetId() const override;
 	virtual void GetAssetRegistryTags(FAssetRegistryTagsContext Context) const override;
+	virtual void PostLoad() override;
+#if WITH_EDITOR
+	virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
+#endif
 
 	/** The tags that this item has.
 	 * @note You can search for items with specific tags through the AssetRegistry.
@@ -83,6 +87,31 @@ public:
 
 	template<typename T> requires std::derived_from<T, FCrimItemDefinitionFragment>
 	const T* GetFragmentByType() const;
+
+	/** Returns the first fragment that is the FragmentType or a child of it. */
+	const TInstancedStruct<FCrimItemDefinitionFragment>* FindFragment(const UScriptStruct* FragmentType) const;
+
+	/** Returns the registry handle of this ItemDefinition. See UCrimItemDefinitionRegistry. */
+	FCrimItemDefinitionHandle GetItemDefinitionHandle() const;
+
+	/**
+	 * Returns an item created from this ItemDefinition with its default values. Replication compares against it to
+	 * skip fragments that were not modified, for the fragment types that opt in with
+	 * FCrimItemFragment::CanReplicateAsDefault.
+	 */
+	const TInstancedStruct<FCrimItem>& GetDefaultItem() const;
+
+private:
+	/** Maps each fragment struct, and its parent structs, to the index of the first fragment of that type. */
+	mutable TMap<const UScriptStruct*, int32> FragmentMap;
+	/** The number of Fragments when the FragmentMap was built. */
+	mutable int32 FragmentMapNum = INDEX_NONE;
+
+	void BuildFragmentMap() const;
+
+	/** Built on first use by GetDefaultItem. */
+	mutable TInstancedStruct<FCrimItem> DefaultItem;
+	mutable bool bDefaultItemBuilt = false;
 };
 
 /**
@@ -91,12 +120,9 @@ public:
 template <typename T> requires std::derived_from<T, FCrimItemDefinitionFragment>
 const T* UCrimItemDefinition::GetFragmentByType() const
 {
-	for (const TInstancedStruct<FCrimItemDefinitionFragment>& Fragment : Fragments)
+	if (const TInstancedStruct<FCrimItemDefinitionFragment>* Fragment = FindFragment(T::StaticStruct()))
 	{
-		if (const T* FragmentPtr = Fragment.GetPtr<T>())
-		{
-			return FragmentPtr;
-		}
+		return Fragment->GetPtr<T>();
 	}
 	return nullptr;
 }
\ No newline at end of file
@@ -0,0 +1,46 @@
+﻿// Copyright Soccertitan
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "CrimItemTypes.h"
+#include "Subsystems/EngineSubsystem.h"
+#include "CrimItemDefinitionRegistry.generated.h"
+
+struct FAssetData;
+
+/**
+ * Assigns every UCrimItemDefinition a dense FCrimItemDefinitionHandle. All definitions known to the AssetRegistry are
+ * registered when the engine starts, sorted by path. Definitions that are not known yet, such as newly created assets
+ * in the editor, are registered the first time a handle is requested for them.
+ */
+UCLASS()
+class CRIMITEMSYSTEM_API UCrimItemDefinitionRegistry : public UEngineSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	/**
+	 * Returns the handle for the ItemDefinition, registering it if needed. Safe to call from any thread.
+	 * @return An invalid handle if the ItemDefinition is null.
+	 */
+	static FCrimItemDefinitionHandle FindOrAddHandle(const FSoftObjectPath& ItemDefinition);
+
+	/** Returns the handle for the ItemDefinition, or an invalid handle if it has not been registered. */
+	static FCrimItemDefinitionHandle FindHandle(const FSoftObjectPath& ItemDefinition);
+
+	/** Returns the ItemDefinition the Handle was assigned to, or a null path if the Handle is invalid. */
+	static FSoftObjectPath GetItemDefinition(FCrimItemDefinitionHandle Handle);
+
+	/** Returns the number of registered ItemDefinitions. Every valid handle index is lower than it. */
+	static int32 GetNumHandles();
+
+private:
+	FDelegateHandle OnFilesLoadedHandle;
+
+	/** Registers every ItemDefinition that the AssetRegistry knows about. */
+	static void RegisterAllItemDefinitions();
+};
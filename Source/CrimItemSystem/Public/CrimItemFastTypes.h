@@ -10,6 +10,7 @@
 #include "CrimItemFastTypes.generated.h"
 
 class UCrimItemContainerBase;
+class UNetConnection;
 struct FFastCrimItemContainerList;
 class UCrimItemManagerComponent;
 struct FFastCrimItem;
@@ -32,6 +33,7 @@ struct CRIMITEMSYSTEM_API FFastCrimItem : public FFastArraySerializerItem
 	friend struct FFastCrimItemList;
 
 	void Initialize(const TInstancedStruct<FCrimItem>& InItem);
+	void Initialize(TInstancedStruct<FCrimItem>&& InItem);
 
 	//~ Begin of FFastArraySerializerItem
 	void PostReplicatedAdd(const FFastCrimItemList& InItemList);
@@ -43,19 +45,75 @@ struct CRIMITEMSYSTEM_API FFastCrimItem : public FFastArraySerializerItem
 	UPROPERTY(BlueprintReadOnly, meta = (AllowPrivateAccess))
 	TInstancedStruct<FCrimItem> Item;
 
-	/** Holds the previous value of the item during a broadcast event.*/
+	/**
+	 * Holds the previous value of the item during a broadcast event.
+	 * @note Empty unless the ItemContainer enables bKeepPreReplicatedItems.
+	 */
 	TInstancedStruct<FCrimItem> GetPreReplicatedItem() const { return PreReplicatedChangeItem; }
+
+	/** Returns the heap memory used by the Item and its PreReplicatedChangeItem. */
+	SIZE_T GetAllocatedSize() const;
+
+	/**
+	 * Returns the size of the Item written by FCrimItem::NetSerialize without a package map, cached until the Item
+	 * changes. The ItemDefinition is counted as a path, like the first time it is sent to a connection, and replicated
+	 * properties declared by child structs are not counted.
+	 */
+	int32 GetNetSizeEstimate() const;
+
+	/**
+	 * Sends the struct type of the Item followed by FCrimItem::NetSerialize, in place of the generic TInstancedStruct
+	 * serialization which sends every property with its full path and tag.
+	 * When the ItemList is written for a connection that already has an older version of the item, and the changes
+	 * since that version were all recorded, only the changed sections are sent. See FCrimItem::NetSerializeSections.
+	 */
+	bool NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess);
 private:
 
 	/* A copy of the Item which we use as a lookup for the previous values of changed properties. */
 	UPROPERTY(NotReplicated, BlueprintReadOnly, meta = (AllowPrivateAccess))
 	TInstancedStruct<FCrimItem> PreReplicatedChangeItem;
+
+	struct FNetSectionChange
+	{
+		int32 ReplicationKey;
+		ECrimItemNetSection Sections;
+	};
+
+	/** The sections changed by each of the last ReplicationKeys, oldest first. Only kept on the server. */
+	TArray<FNetSectionChange, TInlineAllocator<2>> NetSectionHistory;
+
+	/** Sections modified while the ItemContainer was batching, not marked dirty in the ItemList yet. */
+	ECrimItemNetSection PendingNetSections = ECrimItemNetSection::None;
+
+	/** Returns the sections changed after the BaseReplicationKey, or All if the history does not go back that far. */
+	ECrimItemNetSection GetNetSectionsChangedSince(int32 BaseReplicationKey) const;
+
+	/** Items with a higher priority are sent first when the ItemList is over its net update budget. Only used on the server. */
+	uint32 NetPriority = 0;
+
+	/** The estimated size in bytes of the Item when replicated in full, as of NetSizeReplicationKey. See GetNetSizeEstimate. */
+	mutable int32 NetSizeEstimate = INDEX_NONE;
+	mutable int32 NetSizeReplicationKey = INDEX_NONE;
+};
+
+template<>
+struct TStructOpsTypeTraits<FFastCrimItem> : public TStructOpsTypeTraitsBase2<FFastCrimItem>
+{
+	enum
+	{
+		WithNetSerializer = true
+	};
 };
 
 /**
  * FastArraySerializer of CrimItem.
  *  
  * This should only be used by UCrimItemManagerComponent.
+ *
+ * With Iris, the list is replicated by the engine's fast array fragment and each item is forwarded whole to
+ * FFastCrimItem::NetSerialize. There is no native Iris NetSerializer for the items, so NetDeltaSerialize does not run:
+ * items are always sent in full rather than by changed sections, and the net update budget does not apply.
  */
 USTRUCT(BlueprintType)
 struct CRIMITEMSYSTEM_API FFastCrimItemList : public FFastArraySerializer
@@ -70,32 +128,282 @@ struct CRIMITEMSYSTEM_API FFastCrimItemList : public FFastArraySerializer
 
     FFastCrimItemList(){}
 
-    bool NetDeltaSerialize(FNetDeltaSerializeInfo& DeltaParams)
-    {
-        return FastArrayDeltaSerialize<FFastCrimItem, FFastCrimItemList>(Items, DeltaParams, *this);
-    }
+    bool NetDeltaSerialize(FNetDeltaSerializeInfo& DeltaParams);
 
     /** Adds an Item to the list. */
     void AddItem(const TInstancedStruct<FCrimItem>& Item);
 
+	/** Adds an Item to the list, moving it in place of copying it. */
+	void AddItem(TInstancedStruct<FCrimItem>&& Item);
+
+	/**
+	 * Adds an Item predicted by a client. It is kept apart from the replicated Items, so the FastArraySerializer never
+	 * sees it, and is dropped once the server's copy of the Item, with the same ItemGuid, is received.
+	 * The queries include the predicted Items, GetItems does not.
+	 */
+	void AddPredictedItem(TInstancedStruct<FCrimItem>&& Item);
+
+	/** Removes an Item added by AddPredictedItem, broadcasting its removal. */
+	bool RemovePredictedItem(const FGuid& ItemGuid);
+
+	/** Returns true if a predicted Item with the ItemGuid is in the list. See AddPredictedItem. */
+	bool HasPredictedItem(const FGuid& ItemGuid) const;
+
     /** Removes an Item from the list. */
     bool RemoveItem(const FGuid& ItemGuid);
 
-    /** Returns a const reference of all the Items within the container. */
+	/** Removes an Item from the list and moves it into OutItem. */
+	bool RemoveItem(const FGuid& ItemGuid, TInstancedStruct<FCrimItem>& OutItem);
+
+    /** Returns a const reference of all the replicated Items within the container. Predicted Items are not included. */
     const TArray<FFastCrimItem>& GetItems() const;
 
 	/** Returns a pointer to an Item. */
 	FFastCrimItem* GetItem(const FGuid& ItemGuid) const;
 
+	/**
+	 * Calls Func for every Item. Return false from Func to stop iterating.
+	 * @note Func must not add or remove Items from the list.
+	 */
+	void ForEachItem(TFunctionRef<bool(FFastCrimItem&)> Func) const;
+
+	/**
+	 * Calls Func for every Item with the ItemDefinition. Return false from Func to stop iterating.
+	 * @note Func must not add or remove Items from the list.
+	 */
+	void ForEachItemByDefinition(FCrimItemDefinitionHandle ItemDefinition, TFunctionRef<bool(FFastCrimItem&)> Func) const;
+
+	/**
+	 * Calls Func for every Item that matches the TestItem. Return false from Func to stop iterating.
+	 * @note Func must not add or remove Items from the list, but may change and mark them dirty.
+	 * The matches are gathered before the first call, an Item changed into a match while iterating is not visited.
+	 */
+	void ForEachMatchingItem(const TInstancedStruct<FCrimItem>& TestItem, TFunctionRef<bool(FFastCrimItem&)> Func) const;
+
+	/**
+	 * Calls Func for every Item that matches the TestItem and has less than MaxQuantity. Stacks that are already full
+	 * are skipped from the quantity column without reading their Item. Same rules as ForEachMatchingItem.
+	 */
+	void ForEachMatchingItemBelowQuantity(const TInstancedStruct<FCrimItem>& TestItem, int32 MaxQuantity, TFunctionRef<bool(FFastCrimItem&)> Func) const;
+
+	/** Returns a pointer to the first Item with the ItemDefinition. */
+	FFastCrimItem* GetItemByDefinition(FCrimItemDefinitionHandle ItemDefinition) const;
+
+	/** Returns pointers to all Items with the ItemDefinition. */
+	TArray<FFastCrimItem*> GetItemsByDefinition(FCrimItemDefinitionHandle ItemDefinition) const;
+
+	/**
+	 * Returns the first Item that matches the TestItem.
+	 * Only Items sharing the TestItem's stack signature are checked with FCrimItem::IsMatching, unless the TestItem
+	 * opts out with FCrimItem::UsesStackSignature.
+	 */
+	FFastCrimItem* FindMatchingItem(const TInstancedStruct<FCrimItem>& TestItem) const;
+
+	/**
+	 * Returns all Items that match the TestItem.
+	 * Only Items sharing the TestItem's stack signature are checked with FCrimItem::IsMatching, unless the TestItem
+	 * opts out with FCrimItem::UsesStackSignature.
+	 */
+	TArray<FFastCrimItem*> FindMatchingItems(const TInstancedStruct<FCrimItem>& TestItem) const;
+
+	/** Returns the number of Items with the ItemDefinition. */
+	int32 GetStackCountByDefinition(FCrimItemDefinitionHandle ItemDefinition) const;
+
+	/** Returns the summed quantity of all Items with the ItemDefinition. */
+	int32 GetQuantityByDefinition(FCrimItemDefinitionHandle ItemDefinition) const;
+
+	/**
+	 * Marks the Item dirty for replication and records which Sections changed, so connections that already have the
+	 * previous version of the Item are only sent those sections.
+	 */
+	void MarkItemSectionsDirty(FFastCrimItem& FastItem, ECrimItemNetSection Sections);
+
+	/**
+	 * Sets how many Items a connection that does not have them yet is sent per net update, 0 for no limit. The others
+	 * are held back for later updates, the most recently added or prioritized first.
+	 * @note Items a connection already has are always sent when changed, since leaving them out of an update replicates
+	 * as their removal.
+	 */
+	void SetMaxNewItemsPerNetUpdate(int32 MaxItems);
+	int32 GetMaxNewItemsPerNetUpdate() const;
+
+	/**
+	 * Sets how many bytes of Items a connection that does not have them yet is sent per net update, 0 for no limit.
+	 * Items are held back once either this or the MaxNewItemsPerNetUpdate budget is used up, but the first new Item is
+	 * always sent. See FFastCrimItem::GetNetSizeEstimate.
+	 */
+	void SetMaxNewItemBytesPerNetUpdate(int32 MaxBytes);
+	int32 GetMaxNewItemBytesPerNetUpdate() const;
+
+	/**
+	 * Returns the ReplicationIDs of the Items over the net update budget of a connection, which are left out of its
+	 * next update. Items the connection already has are never held back.
+	 * @param BaseReplicationKeys The Items the connection already has, or null if it has none.
+	 * @return The number of Items held back.
+	 */
+	int32 SelectHeldBackItems(const TMap<int32, int32>* BaseReplicationKeys, TSet<int32>& OutHeldBackItemIDs) const;
+
+	/** Moves the Item ahead of all others held back by the net update budget. */
+	void PrioritizeItemReplication(FFastCrimItem& FastItem);
+
+	/** Returns how many Items have been held back by the net update budget. */
+	const FCrimItemNetBacklogStats& GetNetBacklogStats() const;
+
+	/** Hides FFastArraySerializer::ShouldWriteFastArrayItem to leave out the Items held back by the net update budget. */
+	template<typename Type, typename SerializerType>
+	bool ShouldWriteFastArrayItem(const Type& Item, const bool bIsWritingOnClient)
+	{
+		if (bIsWritingOnClient)
+		{
+			return Item.ReplicationID != INDEX_NONE;
+		}
+		return HeldBackItemIDs.IsEmpty() || !HeldBackItemIDs.Contains(Item.ReplicationID);
+	}
+
+	/** Updates the lookup maps and totals after an Item in the list has been modified. */
+	void RefreshItemIndex(const FFastCrimItem& FastItem);
+
     /** Returns the number of Items in the container. */
     int32 GetNum() const;
 
-	/** Removes all items from this container. */
+	/** Returns the heap memory used by the Items and the lookup maps. */
+	SIZE_T GetAllocatedSize() const;
+
+	/** Sets the ItemContainer the list belongs to. Received Items are pointed to it and its ItemManager. */
+	void SetOwningContainer(UCrimItemContainerBase* ItemContainer);
+
+	/** Sets whether the Items keep a copy of their previous value. See FFastCrimItem::GetPreReplicatedItem. */
+	void SetKeepPreReplicatedItems(bool bKeep);
+	bool IsKeepingPreReplicatedItems() const;
+
+	/**
+	 * Returns the modification version of the list. It increases every time an Item is added, removed or refreshed, so
+	 * pointers into the list obtained at an older version must not be used.
+	 */
+	uint32 GetVersion() const;
+
+	/** Removes all items from this container and frees the memory of the Items and lookup maps. */
 	void Reset();
 
+	/**
+	 * Reserves memory for at least Number Items, so adding them does not reallocate the Items or lookup maps.
+	 * Removing Items does not shrink the memory on its own, see ConditionalShrink.
+	 */
+	void Reserve(int32 Number);
+
+	/**
+	 * Frees the unused memory of the Items and lookup maps once less than a quarter of it is in use, unless the
+	 * capacity is at most the MinShrinkCapacity. Shrinking moves the Items, so it must not be called while pointers to
+	 * them are held.
+	 */
+	void ConditionalShrink();
+
+	/** Sets the Item capacity up to which ConditionalShrink keeps the memory around. */
+	void SetMinShrinkCapacity(int32 Capacity);
+	int32 GetMinShrinkCapacity() const;
+
+	//~ Begin of FFastArraySerializer
+	void PostReplicatedReceive(const FFastArraySerializer::FPostReplicatedReceiveParameters& Parameters);
+	//~ End of FFastArraySerializer
+
 private:
 	UPROPERTY()
 	TArray<FFastCrimItem> Items;
+
+	// Lookup maps into Items. Kept up to date on the server as items are added and removed. On clients the replicated
+	// array is rearranged by the FastArraySerializer, so the maps are flagged dirty and lazily rebuilt.
+	// The Item arrays below are parallel to Items. They let the index be updated from the indexed values, and let
+	// queries such as ForEachMatchingItemBelowQuantity filter on them before dereferencing an item.
+
+	/** The ItemGuid of each item. */
+	mutable TArray<FGuid> ItemGuids;
+	/** The interned ItemDefinition id of each item. See DefinitionIds. */
+	mutable TArray<int32> ItemDefinitionIds;
+	/** The stack signature of each item. See FCrimItem::GetStackSignature. */
+	mutable TArray<uint64> ItemSignatures;
+	/** The quantity of each item when it was last indexed. */
+	mutable TArray<int32> ItemQuantities;
+
+	/** Maps an ItemGuid to its index in Items. */
+	mutable TMap<FGuid, int32> ItemGuidMap;
+	/** Maps an ItemDefinition handle to an id local to this list, so the arrays below only grow with the definitions in use. */
+	mutable TMap<FCrimItemDefinitionHandle, int32> DefinitionIds;
+	/** The indices of all Items using the ItemDefinition, by interned id. */
+	mutable TArray<TArray<int32>> ItemIndicesByDefinition;
+	/** The summed ItemQuantities of all Items using the ItemDefinition, by interned id. */
+	mutable TArray<int32> QuantityByDefinition;
+	/** Maps a stack signature to the indices of all Items sharing it. */
+	mutable TMap<uint64, TArray<int32>> ItemSignatureMap;
+	mutable bool bIndexMapsDirty = false;
+
+	/** Increased on every modification. See GetVersion. */
+	uint32 Version = 0;
+
+	/** If true, the Items copy their value into PreReplicatedChangeItem after every change. */
+	bool bKeepPreReplicatedItems = false;
+
+	/** See SetMinShrinkCapacity. */
+	int32 MinShrinkCapacity = 64;
+
+	/** The ItemContainer the list belongs to. See SetOwningContainer. */
+	TWeakObjectPtr<UCrimItemContainerBase> OwningContainer;
+
+	/** The Items added by AddPredictedItem. Mutable as the server's copy replaces them from FFastCrimItem::PostReplicatedAdd. */
+	mutable TArray<FFastCrimItem> PredictedItems;
+
+	/** Returns the index of the predicted Item with the ItemGuid in PredictedItems, or INDEX_NONE. */
+	int32 FindPredictedItemIndex(const FGuid& ItemGuid) const;
+
+	/** See SetMaxNewItemsPerNetUpdate. */
+	int32 MaxNewItemsPerNetUpdate = 0;
+	/** See SetMaxNewItemBytesPerNetUpdate. */
+	int32 MaxNewItemBytesPerNetUpdate = 0;
+	/** The last NetPriority given to an Item. */
+	uint32 LastNetPriority = 0;
+	/** The ReplicationIDs of the Items held back from the connection currently being written. See SelectHeldBackItems. */
+	TSet<int32> HeldBackItemIDs;
+	/** The number of Items held back from each connection in its last update. Only connections with a backlog. */
+	TMap<TObjectKey<UNetConnection>, int32> BacklogByConnection;
+	FCrimItemNetBacklogStats NetBacklogStats;
+
+	/** Records the Backlog of the Connection and updates the NetBacklogStats from all connections. */
+	void UpdateNetBacklogStats(const UNetConnection* Connection, int32 Backlog);
+
+	/** Rebuilds the lookup maps if they have been flagged dirty or no longer match the number of items. */
+	void ConditionalRebuildIndexMaps() const;
+
+	/** Adds the item at Index to the lookup maps. */
+	void AddToIndexMaps(int32 Index) const;
+
+	/** Returns the interned id of the ItemDefinition or INDEX_NONE if no Item uses it. */
+	int32 FindDefinitionId(FCrimItemDefinitionHandle ItemDefinition) const;
+	/** Returns the interned id of the ItemDefinition, interning it if needed. */
+	int32 FindOrAddDefinitionId(FCrimItemDefinitionHandle ItemDefinition) const;
+
+	/** Returns the index of the item in Items or INDEX_NONE. */
+	int32 FindItemIndex(const FGuid& ItemGuid) const;
+
+	/**
+	 * Removes the item at Index with RemoveAtSwap and fixes up the indices of the item that was moved into its slot.
+	 * @param OutRemovedItem If set, the removed item is moved into it.
+	 */
+	void RemoveItemAt(int32 Index, FFastCrimItem* OutRemovedItem = nullptr);
+
+#if DO_CHECK && !UE_BUILD_SHIPPING
+	/**
+	 * Recounts the lookup maps and totals from scratch and checks them against the incrementally maintained ones.
+	 * Does nothing unless CrimItemSystem.ValidateItemIndex is enabled.
+	 */
+	void ValidateIndexMaps() const;
+
+	/**
+	 * Checks that every Item matching the TestItem shares its stack signature, which catches an FCrimItem overriding
+	 * IsMatching without GetStackSignature. Does nothing unless CrimItemSystem.ValidateItemIndex is enabled.
+	 */
+	void ValidateStackSignatures(const TInstancedStruct<FCrimItem>& TestItem) const;
+#endif
+
+	friend FFastCrimItem;
 };
 
 template<>
@@ -122,6 +430,7 @@ struct CRIMITEMSYSTEM_API FFastCrimItemContainerItem : public FFastArraySerializ
 
 	//~ Begin of FFastArraySerializerItem
 	void PostReplicatedAdd(const FFastCrimItemContainerList& InItemContainerList);
+	void PostReplicatedChange(const FFastCrimItemContainerList& InItemContainerList);
 	void PreReplicatedRemove(const FFastCrimItemContainerList& InItemContainerList);
 	//~ End of FFastArraySerializerItem
 
@@ -169,6 +478,12 @@ struct CRIMITEMSYSTEM_API FFastCrimItemContainerList : public FFastArraySerializ
 	/** Gets a const reference to the item containers. */
 	const TArray<FFastCrimItemContainerItem>& GetItemContainers() const;
 
+	/** Returns the item container with the matching ContainerGuid or nullptr. */
+	UCrimItemContainerBase* GetItemContainer(const FGameplayTag& ContainerGuid) const;
+
+	/** Returns true if the item container is in the list. */
+	bool Contains(const UCrimItemContainerBase* ItemContainer) const;
+
 	bool NetDeltaSerialize(FNetDeltaSerializeInfo& DeltaParms)
 	{
 		return FastArrayDeltaSerialize<FFastCrimItemContainerItem, FFastCrimItemContainerList>(Items, DeltaParms, *this);
@@ -178,6 +493,20 @@ private:
 	/** Replicated list of item containers. */
 	UPROPERTY(BlueprintReadOnly, meta = (AllowPrivateAccess = true))
 	TArray<FFastCrimItemContainerItem> Items;
+
+	/** All item containers in the list. */
+	mutable TSet<const UCrimItemContainerBase*> ItemContainerSet;
+
+	/**
+	 * Maps a ContainerGuid to its item container. On clients the ContainerGuid may replicate after the container was
+	 * added to the list, those containers are keyed on the next lookup miss.
+	 */
+	mutable TMap<FGameplayTag, UCrimItemContainerBase*> ItemContainerMap;
+
+	void AddToLookup(UCrimItemContainerBase* ItemContainer) const;
+	void RemoveFromLookup(const UCrimItemContainerBase* ItemContainer) const;
+
+	friend FFastCrimItemContainerItem;
 };
 
 template <>
@@ -38,4 +38,5 @@ public:
 	FGameplayTag ItemPlan_Error_CantContainItem;
 	FGameplayTag ItemPlan_Error_QuantityIsZero;
 	FGameplayTag ItemPlan_Error_MaxStacksReached;
+	FGameplayTag ItemPlan_Error_StalePlan;
 };
@@ -14,10 +14,28 @@
 
 
 class UCrimItemDefinition;
+class UCrimItemContainer;
 class UCrimItemContainerBase;
 
+/** Identifies an item within one of the ItemManager's ItemContainers. */
+struct FCrimItemLocation
+{
+	FCrimItemLocation(){}
+	FCrimItemLocation(UCrimItemContainerBase* InItemContainer, const FGuid& InItemGuid, int32 InQuantity) :
+		ItemContainer(InItemContainer),
+		ItemGuid(InItemGuid),
+		Quantity(InQuantity)
+		{}
+
+	TWeakObjectPtr<UCrimItemContainerBase> ItemContainer;
+	FGuid ItemGuid;
+	/** The quantity of the item when it was last indexed. */
+	int32 Quantity = 0;
+};
+
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_ThreeParams(FCrimItemManagerComponentItemSignature, UCrimItemManagerComponent*, ItemManagerComponent, UCrimItemContainerBase*, ItemContainer, const FFastCrimItem&, Item);
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FCrimItemManagerComponentItemContainerSignature, UCrimItemManagerComponent*, ItemManagerComponent, UCrimItemContainerBase*, ItemContainer);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_FourParams(FCrimItemManagerComponentItemMovedSignature, UCrimItemManagerComponent*, ItemManagerComponent, UCrimItemContainerBase*, SourceContainer, UCrimItemContainerBase*, TargetContainer, const FFastCrimItem&, Item);
 
 /**
  * Manages a collection of ItemContainers and their items.
@@ -27,6 +45,8 @@ class CRIMITEMSYSTEM_API UCrimItemManagerComponent : public UActorComponent
 {
 	GENERATED_BODY()
 
+	friend UCrimItemContainerBase;
+
 public:
 	UCrimItemManagerComponent();
 	virtual void BeginPlay() override;
@@ -47,6 +67,14 @@ public:
 	UPROPERTY(BlueprintAssignable, DisplayName = "OnItemChanged")
 	FCrimItemManagerComponentItemSignature OnItemChangedDelegate;
 
+	/**
+	 * Called in place of OnItemRemoved and OnItemAdded when MoveItem moves a whole item, keeping its ItemGuid, between
+	 * two ItemContainers of this ItemManager. Clients receive the move as a removal and an add, or as a move when the
+	 * add is received first.
+	 */
+	UPROPERTY(BlueprintAssignable, DisplayName = "OnItemMoved")
+	FCrimItemManagerComponentItemMovedSignature OnItemMovedDelegate;
+
 	/** Called when an ItemContainer has been added to the list. */
 	UPROPERTY(BlueprintAssignable, DisplayName = "OnItemContainerAdded")
 	FCrimItemManagerComponentItemContainerSignature OnItemContainerAddedDelegate;
@@ -83,6 +111,12 @@ public:
 	UFUNCTION(BlueprintPure, Category = "CrimItemManagerComponent", DisplayName = "GetItemByGuid")
 	TInstancedStruct<FCrimItem> K2_GetItemByGuid(FGuid ItemGuid) const;
 
+	/**
+	 * Calls Func for every item with the ItemDefinition across all ItemContainers. Return false from Func to stop iterating.
+	 * @note Func must not add items. It may only remove them while a FCrimItemBatchScope is open on the ItemManager.
+	 */
+	void ForEachItemByDefinition(const UCrimItemDefinition* ItemDefinition, TFunctionRef<bool(UCrimItemContainerBase*, FFastCrimItem&)> Func) const;
+
 	/**
 	 * @param ItemDefinition The ItemDef to check.
 	 * @return A pointer of all items with matching item definitions.
@@ -96,6 +130,15 @@ public:
 	UFUNCTION(BlueprintCallable, BlueprintPure = false, Category = "CrimItemManagerComponent", DisplayName = "GetItemsByDefinition")
 	TArray<TInstancedStruct<FCrimItem>> K2_GetItemsByDefinition(const UCrimItemDefinition* ItemDefinition) const;
 
+	/** Returns the number of item stacks with the ItemDefinition across all ItemContainers. */
+	int32 GetItemStackCountByDefinition(FCrimItemDefinitionHandle ItemDefinition) const;
+
+	/** Returns the version of the item index. It increases every time an item is added, removed or changed in any ItemContainer. */
+	uint32 GetItemIndexVersion() const;
+
+	/** Returns the summed quantity of all items with the ItemDefinition across all ItemContainers. */
+	int32 GetItemQuantityByDefinition(FCrimItemDefinitionHandle ItemDefinition) const;
+
 	/**
 	 * Gets all items with the matching ItemDef. Then subtracts quantity from them until the amount subtracted has reached
 	 * 0. Then, if an item's quantity is 0, removes the item from the ItemContainer.
@@ -105,6 +148,25 @@ public:
 	UFUNCTION(BlueprintCallable, BlueprintAuthorityOnly, Category = "CrimItemManagerComponent")
 	void ConsumeItemsByDefinition(const UCrimItemDefinition* ItemDefinition, int32 Quantity);
 
+	/**
+	 * Consumes every ingredient from the items across all ItemContainers. If any ingredient is short, nothing is consumed.
+	 * Ingredients sharing an ItemDefinition are combined. Items reaching 0 quantity are removed.
+	 * @param Ingredients The ItemDefinitions and quantities to consume.
+	 * @return The quantity consumed from each item, or the missing ingredients.
+	 */
+	UFUNCTION(BlueprintCallable, BlueprintAuthorityOnly, Category = "CrimItemManagerComponent")
+	FCrimConsumeRecipeResult ConsumeRecipe(const TArray<FCrimItemRecipeIngredient>& Ingredients);
+
+	/**
+	 * Moves an item from whichever ItemContainer owns it into the TargetContainer.
+	 * @param ItemGuid The item to move.
+	 * @param TargetContainer The ItemContainer to move the item into.
+	 * @param Quantity The amount to move. If 0 or more than the item's quantity, moves the whole stack.
+	 * @return The result of adding the item to the TargetContainer.
+	 */
+	UFUNCTION(BlueprintCallable, BlueprintAuthorityOnly, Category = "CrimItemManagerComponent")
+	FCrimAddItemResult MoveItem(const FGuid ItemGuid, UCrimItemContainerBase* TargetContainer, int32 Quantity = 0);
+
 	/**
 	 * Creates a new item container and initializes it.
 	 * @param ContainerGuid The Guid to set the new container with. If invalid, will create one anyway.
@@ -137,6 +199,22 @@ public:
 	/* Returns true if this Component's Owner Actor has authority. */
 	bool HasAuthority() const;
 
+	// Client prediction. The ItemContainers send the changes their owning client predicted, and the server answers each
+	// one with ClientPredictionResult. See UCrimItemContainerBase::bAllowClientPrediction.
+
+	UFUNCTION(Server, Reliable)
+	void ServerSplitItemStack(UCrimItemContainer* ItemContainer, FGuid ItemGuid, int32 Quantity, FGuid NewItemGuid, int32 PredictionKey);
+
+	UFUNCTION(Server, Reliable)
+	void ServerStackItems(UCrimItemContainer* ItemContainer, FGuid SourceItemGuid, FGuid TargetItemGuid, int32 Quantity, int32 PredictionKey);
+
+	UFUNCTION(Server, Reliable)
+	void ServerConsumeItem(UCrimItemContainerBase* ItemContainer, FGuid ItemGuid, int32 Quantity, bool bRemoveItem, int32 PredictionKey);
+
+	/** Tells the client whether the server made the change it predicted. */
+	UFUNCTION(Client, Reliable)
+	void ClientPredictionResult(UCrimItemContainerBase* ItemContainer, int32 PredictionKey, bool bAccepted);
+
 protected:
 
 	virtual void OnItemContainerAdded(const FFastCrimItemContainerItem& Entry);
@@ -145,6 +223,7 @@ protected:
 	virtual void OnItemAdded(UCrimItemContainerBase* ItemContainer, const FFastCrimItem& Item);
 	virtual void OnItemRemoved(UCrimItemContainerBase* ItemContainer, const FFastCrimItem& Item);
 	virtual void OnItemChanged(UCrimItemContainerBase* ItemContainer, const FFastCrimItem& Item);
+	virtual void OnItemMoved(UCrimItemContainerBase* SourceContainer, UCrimItemContainerBase* TargetContainer, const FFastCrimItem& Item);
 
 private:
 	/** Cached value of whether our owner is a simulated Actor. */
@@ -165,4 +244,71 @@ private:
 	void InitializeStartupItems();
 	void BindToItemContainerListDelegates();
 	void BindToItemContainerDelegates(UCrimItemContainerBase* ItemContainer);
+
+	void Internal_OnItemAdded(UCrimItemContainerBase* ItemContainer, const FFastCrimItem& Item);
+	void Internal_OnItemRemoved(UCrimItemContainerBase* ItemContainer, const FFastCrimItem& Item);
+	void Internal_OnItemChanged(UCrimItemContainerBase* ItemContainer, const FFastCrimItem& Item);
+
+	// Lookup maps across all ItemContainers. Updated from the ItemContainer delegates.
+
+	/** Where an indexed item is found. */
+	struct FItemIndexEntry
+	{
+		TWeakObjectPtr<UCrimItemContainerBase> ItemContainer;
+		FCrimItemDefinitionHandle ItemDefinition;
+		/** The index of the item in the ItemLocationsByDefinition of its ItemDefinition. */
+		int32 LocationIndex = INDEX_NONE;
+	};
+
+	/** Maps an ItemGuid to the ItemContainer holding it and its location. */
+	TMap<FGuid, FItemIndexEntry> ItemIndexByItemGuid;
+	/** Maps an ItemDefinition to the location of every item using it. */
+	TMap<FCrimItemDefinitionHandle, TArray<FCrimItemLocation>> ItemLocationsByDefinition;
+	/** Maps an ItemDefinition to the summed quantity of its ItemLocationsByDefinition. */
+	TMap<FCrimItemDefinitionHandle, int32> ItemQuantityByDefinition;
+	/** See GetItemIndexVersion. */
+	uint32 ItemIndexVersion = 0;
+
+	/** Set by UCrimItemContainerBase::MoveItem while the item is moved out of the ItemContainer. See OnItemMovedDelegate. */
+	TWeakObjectPtr<UCrimItemContainerBase> MovingItemSource;
+	FGuid MovingItemGuid;
+
+	/** Returns true if the ItemContainer is managed by this ItemManager and lets clients predict changes to it. */
+	bool CanAcceptPrediction(const UCrimItemContainerBase* ItemContainer) const;
+
+	/**
+	 * Sends the result of a predicted change to the client. When it was rejected, the ItemGuids are replicated in full
+	 * so the client's copies are corrected even if the rollback restores an outdated value.
+	 */
+	void SendPredictionResult(UCrimItemContainerBase* ItemContainer, int32 PredictionKey, bool bAccepted, TConstArrayView<FGuid> ItemGuids);
+
+	/**
+	 * Indexes the Item in the ItemContainer. If the ItemGuid is still indexed in another ItemContainer, the item was moved
+	 * and its removal from there has not been received yet, so its entry is moved over.
+	 * @return The ItemContainer the item was moved from, or nullptr.
+	 */
+	UCrimItemContainerBase* AddToItemIndex(UCrimItemContainerBase* ItemContainer, const FFastCrimItem& Item);
+	void RemoveFromItemIndex(UCrimItemContainerBase* ItemContainer, const FFastCrimItem& Item);
+	void UpdateItemIndex(UCrimItemContainerBase* ItemContainer, const FFastCrimItem& Item);
+	/** Removes the ItemGuid from the index, whichever ItemContainer it is indexed in. */
+	void RemoveItemIndexEntry(const FGuid& ItemGuid);
+	/** Removes the items indexed in ItemContainers that were destroyed. */
+	void RemoveStaleItemIndexEntries();
+
+	/**
+	 * Subtracts Quantity from the items with the ItemDefinition and removes the items reaching 0 quantity.
+	 * @note Must be called inside a FCrimItemBatchScope on this ItemManager, as the items are removed while iterating.
+	 * @param OutConsumedItems If set, each item quantity was taken from is added to it.
+	 * @return The quantity consumed.
+	 */
+	int32 Internal_ConsumeItemsByDefinition(const UCrimItemDefinition* ItemDefinition, int32 Quantity,
+		TArray<FCrimConsumedItem>* OutConsumedItems = nullptr);
+
+#if DO_CHECK && !UE_BUILD_SHIPPING
+	/**
+	 * Recounts the item totals from the ItemContainers and checks them against the incrementally maintained ones.
+	 * Does nothing unless CrimItemSystem.ValidateItemIndex is enabled.
+	 */
+	void ValidateItemIndex() const;
+#endif
 };
@@ -46,7 +46,7 @@ public:
 	static const T* GetItemDefinitionFragmentByType(const TInstancedStruct<FCrimItem>& Item);
 
 	/**
-	 * Iterates through an Item's Fragments and finds the one that is a child of FragmentType.
+	 * Finds the first of an Item's Fragments that is a child of FragmentType.
 	 * @param Item The item to get the ItemFragment from.
 	 * @param FragmentType The type of item fragment to search for.
 	 * @return An InstancedStruct of type CrimItemFragment.
@@ -55,7 +55,7 @@ public:
 	static TInstancedStruct<FCrimItemFragment> K2_GetItemFragment(UPARAM(ref) const TInstancedStruct<FCrimItem>& Item, const UScriptStruct* FragmentType);
 
 	/**
-	 * Iterates through an ItemDefinition's Fragments and finds the one that is a child of FragmentType.
+	 * Finds the first of an ItemDefinition's Fragments that is a child of FragmentType.
 	 * @param ItemDefinition The ItemDefinition to get the ItemDefinitionFragment from.
 	 * @param FragmentType The type of fragment to search for.
 	 * @return An instanced struct of type CrimItemDefinitionFragment.
@@ -6,6 +6,17 @@
 
 CRIMITEMSYSTEM_API DECLARE_LOG_CATEGORY_EXTERN(LogCrimItemSystem, Log, All);
 
+#if DO_CHECK && !UE_BUILD_SHIPPING
+namespace CrimItemSystem
+{
+	/**
+	 * Returns true if the item lookup indices are recounted and checked after every change. Toggled with the
+	 * CrimItemSystem.ValidateItemIndex console variable.
+	 */
+	CRIMITEMSYSTEM_API bool IsItemIndexValidationEnabled();
+}
+#endif
+
 class FCrimItemSystemModule : public IModuleInterface
 {
 public:
@@ -20,6 +20,69 @@ class UCrimItemManagerComponent;
 class UCrimItemContainer;
 class UCrimItemDefinition;
 
+/**
+ * A dense integer id for an ItemDefinition, assigned by the UCrimItemDefinitionRegistry. Comparing and hashing handles
+ * is cheaper than comparing soft object paths.
+ * @note Handles are only valid for the lifetime of the process. Never save or replicate them, use the ItemDefinition's
+ * soft object path instead.
+ */
+struct CRIMITEMSYSTEM_API FCrimItemDefinitionHandle
+{
+	FCrimItemDefinitionHandle() = default;
+	explicit FCrimItemDefinitionHandle(int32 InIndex) : Index(InIndex) {}
+
+	bool IsValid() const { return Index != INDEX_NONE; }
+	int32 GetIndex() const { return Index; }
+
+	bool operator==(const FCrimItemDefinitionHandle& Other) const { return Index == Other.Index; }
+	bool operator!=(const FCrimItemDefinitionHandle& Other) const { return Index != Other.Index; }
+
+	friend uint32 GetTypeHash(const FCrimItemDefinitionHandle& Handle) { return ::GetTypeHash(Handle.Index); }
+
+private:
+	int32 Index = INDEX_NONE;
+};
+
+/**
+ * The parts of an item that can be replicated on their own. Marking only the sections that changed lets replication
+ * send those sections instead of the whole item. See UCrimItemContainerBase::MarkItemDirty.
+ */
+enum class ECrimItemNetSection : uint32
+{
+	None = 0,
+	Quantity = 1 << 0,
+	TagStats = 1 << 1,
+	/** The first fragment. Use CrimItem::GetFragmentNetSection for the others. */
+	Fragment0 = 1 << 2,
+	/** Everything, including the ItemGuid, ItemDefinition, item struct, number of fragments and child struct properties. */
+	All = 0xFFFFFFFF
+};
+ENUM_CLASS_FLAGS(ECrimItemNetSection);
+
+namespace CrimItem
+{
+	/** Returns the section of the fragment at FragmentIndex. Fragments past the 30th share the last section. */
+	inline ECrimItemNetSection GetFragmentNetSection(int32 FragmentIndex)
+	{
+		return ECrimItemNetSection(uint32(ECrimItemNetSection::Fragment0) << FMath::Clamp(FragmentIndex, 0, 29));
+	}
+
+	/** Upper bounds used to reject corrupt counts when receiving an item. */
+	static constexpr uint32 MaxNetTagStacks = 1024;
+	static constexpr uint32 MaxNetFragments = 256;
+
+	/** Serializes Value with a variable length encoding. Values are ZigZag encoded, so small negative values stay small. */
+	inline void NetSerializePackedInt(FArchive& Ar, int32& Value)
+	{
+		uint32 Packed = (uint32(Value) << 1) ^ uint32(Value >> 31);
+		Ar.SerializeIntPacked(Packed);
+		if (Ar.IsLoading())
+		{
+			Value = int32(Packed >> 1) ^ -int32(Packed & 1);
+		}
+	}
+}
+
 /**
  * Defines limitations for the quantity of an item.
  */
@@ -50,6 +113,20 @@ enum class ECrimAddItemResult : uint8
 	AllItemsAdded UMETA(DisplayName = "All items added")
 };
 
+/**
+ * Which connections an ItemContainer and its items are replicated to.
+ */
+UENUM(BlueprintType)
+enum class ECrimItemContainerReplication : uint8
+{
+	/** Every connection the owning actor is relevant to. */
+	Public,
+	/** Only the connection that owns the owning actor. Use it for private inventories. */
+	OwnerOnly UMETA(DisplayName = "Owner Only"),
+	/** Only connections whose player controller is in the container's net condition group, such as a team. */
+	NetConditionGroup UMETA(DisplayName = "Net Condition Group")
+};
+
 /**
  * Describes how to add a specific item.
  */
@@ -110,10 +187,32 @@ struct CRIMITEMSYSTEM_API FCrimAddItemPlan
 
 	const TArray<FCrimAddItemPlanEntry>& GetEntries() const;
 
+	/** Returns the ItemContainer the plan was built against. */
+	UCrimItemContainerBase* GetItemContainer() const;
+
+	/** Returns the ItemContainer's modification version at the time the plan was built. */
+	uint32 GetItemContainerVersion() const;
+
+	/**
+	 * Returns the ItemManager's item index version at the time the plan was built. The collection limits are counted
+	 * across all of its ItemContainers.
+	 */
+	uint32 GetItemManagerVersion() const;
+
 private:
 	UPROPERTY()
 	TArray<FCrimAddItemPlanEntry> Entries;
 
+	// The ItemContainer and its modification version the plan was built against. Set in UCrimItemContainerBase::PlanAddItem.
+	TWeakObjectPtr<UCrimItemContainerBase> ItemContainer;
+	uint32 ItemContainerVersion = 0;
+	uint32 ItemManagerVersion = 0;
+
+	// The ItemGuid of the item the plan was built for.
+	FGuid ItemGuid;
+
+	friend UCrimItemContainerBase;
+
 	// Adds to the AmountGiven and updates the ECrimItemAddResult.
 	void UpdateAmountGiven(int32 NewValue);
 };
@@ -152,6 +251,124 @@ struct FCrimAddItemResult
 	FGameplayTag Error;
 };
 
+/**
+ * How far the replication of an ItemContainer has fallen behind its net update budget.
+ * See UCrimItemContainerBase::MaxNewItemsPerNetUpdate.
+ */
+USTRUCT(BlueprintType)
+struct CRIMITEMSYSTEM_API FCrimItemNetBacklogStats
+{
+	GENERATED_BODY()
+
+	/** The most Items currently held back from any one connection, as of each connection's last update. */
+	UPROPERTY(BlueprintReadOnly, Category = "CrimItem")
+	int32 CurrentBacklog = 0;
+
+	/** The number of connections Items are currently held back from. */
+	UPROPERTY(BlueprintReadOnly, Category = "CrimItem")
+	int32 NumBackloggedConnections = 0;
+
+	/** The largest number of Items held back from a single connection in one update. */
+	UPROPERTY(BlueprintReadOnly, Category = "CrimItem")
+	int32 PeakBacklog = 0;
+
+	/** The number of updates that held back Items. */
+	UPROPERTY(BlueprintReadOnly, Category = "CrimItem")
+	int32 NumThrottledUpdates = 0;
+};
+
+/**
+ * The items added, changed and removed from an ItemContainer while a FCrimItemBatchScope was open.
+ */
+USTRUCT(BlueprintType)
+struct CRIMITEMSYSTEM_API FCrimItemContainerChangeset
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly)
+	TArray<FGuid> AddedItems;
+
+	// Items that were modified. Does not include items that were also added or removed.
+	UPROPERTY(BlueprintReadOnly)
+	TArray<FGuid> ChangedItems;
+
+	UPROPERTY(BlueprintReadOnly)
+	TArray<FGuid> RemovedItems;
+
+	bool IsEmpty() const;
+};
+
+/**
+ * An ItemDefinition and the quantity of it a recipe requires.
+ */
+USTRUCT(BlueprintType)
+struct CRIMITEMSYSTEM_API FCrimItemRecipeIngredient
+{
+	GENERATED_BODY()
+
+	FCrimItemRecipeIngredient(){}
+	FCrimItemRecipeIngredient(UCrimItemDefinition* InItemDefinition, int32 InQuantity) :
+		ItemDefinition(InItemDefinition),
+		Quantity(InQuantity)
+		{}
+
+	// The ItemDefinition to consume.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	TObjectPtr<UCrimItemDefinition> ItemDefinition;
+
+	// The quantity to consume.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (ClampMin = 1))
+	int32 Quantity = 1;
+};
+
+/**
+ * Describes the quantity consumed from a single item.
+ */
+USTRUCT(BlueprintType)
+struct CRIMITEMSYSTEM_API FCrimConsumedItem
+{
+	GENERATED_BODY()
+
+	// The ItemContainer the item was in.
+	UPROPERTY(BlueprintReadOnly)
+	TObjectPtr<UCrimItemContainerBase> ItemContainer;
+
+	UPROPERTY(BlueprintReadOnly)
+	FGuid ItemGuid;
+
+	UPROPERTY(BlueprintReadOnly)
+	TSoftObjectPtr<UCrimItemDefinition> ItemDefinition;
+
+	// The quantity taken from the item.
+	UPROPERTY(BlueprintReadOnly)
+	int32 Quantity = 0;
+
+	// True if the item reached 0 quantity and was removed.
+	UPROPERTY(BlueprintReadOnly)
+	bool bRemoved = false;
+};
+
+/**
+ * Represents the items consumed by a recipe.
+ */
+USTRUCT(BlueprintType)
+struct CRIMITEMSYSTEM_API FCrimConsumeRecipeResult
+{
+	GENERATED_BODY()
+
+	// True if every ingredient was consumed. If false, nothing was consumed.
+	UPROPERTY(BlueprintReadOnly)
+	bool bSuccess = false;
+
+	// The ingredients there was not enough of, with the quantity that was missing.
+	UPROPERTY(BlueprintReadOnly)
+	TArray<FCrimItemRecipeIngredient> MissingIngredients;
+
+	// Every item quantity was taken from.
+	UPROPERTY(BlueprintReadOnly)
+	TArray<FCrimConsumedItem> ConsumedItems;
+};
+
 /**
  * Params for the ItemDropManager on how to create a new ItemDrop actor.
  */
@@ -222,6 +439,9 @@ private:
 
 /**
  * Container of game item tag stacks, designed for fast replication.
+ * The stacks are kept sorted by the FName comparison index of their tag, so two containers with the same stacks are
+ * always equal and lookups only compare integers. That order is only stable within a process, so it is restored
+ * whenever the stacks are loaded.
  */
 USTRUCT(BlueprintType)
 struct CRIMITEMSYSTEM_API FCrimItemTagStackContainer
@@ -251,8 +471,19 @@ struct CRIMITEMSYSTEM_API FCrimItemTagStackContainer
 	/** Empties all stats in this container. */
 	void Empty();
 
+	/** Restores the sorted order of the stacks and rebuilds the tag lookup. Call after editing the stacks through reflection. */
+	void RefreshCachedState();
+
 	FString ToDebugString() const;
 
+	/** Returns the heap memory used by the stacks. */
+	SIZE_T GetAllocatedSize() const;
+
+	void PostSerialize(const FArchive& Ar);
+
+	/** Sends the stacks as net indexed tags with packed counts. */
+	bool NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess);
+
 	bool operator ==(const FCrimItemTagStackContainer& Other) const
 	{
 		return Items == Other.Items;
@@ -266,6 +497,24 @@ struct CRIMITEMSYSTEM_API FCrimItemTagStackContainer
 private:
 	UPROPERTY(EditAnywhere, SaveGame)
 	TArray<FCrimItemTagStack> Items;
+
+	/** The tags of all the stacks and their parent tags. Used for non exact ContainsTag queries. */
+	mutable FGameplayTagContainer TagCache;
+	mutable bool bTagCacheDirty = true;
+
+	/** Returns the index of the stack with the Tag, or the index it should be inserted at. */
+	int32 LowerBound(const FGameplayTag& Tag) const;
+	void ConditionalRebuildTagCache() const;
+};
+
+template<>
+struct TStructOpsTypeTraits<FCrimItemTagStackContainer> : public TStructOpsTypeTraitsBase2<FCrimItemTagStackContainer>
+{
+	enum
+	{
+		WithPostSerialize = true,
+		WithNetSerializer = true,
+	};
 };
 
 USTRUCT(BlueprintType)
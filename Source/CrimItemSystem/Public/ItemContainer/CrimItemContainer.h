@@ -26,6 +26,8 @@ class CRIMITEMSYSTEM_API UCrimItemContainer : public UCrimItemContainerBase
 {
 	GENERATED_BODY()
 
+	friend UCrimItemManagerComponent;
+
 protected:
 	/** Limits the number of individual item instances that can be in this list. */
 	UPROPERTY(EditAnywhere, Replicated, Category = "CrimItemContainer", SaveGame)
@@ -63,7 +65,7 @@ public:
 	int32 GetMaxCapacity() const;
 
 	/**
-	 * @return Returns the number of items in the list.
+	 * @return Returns the number of items in the list, including the new items planned by PlanAddItems while it runs.
 	 */
 	UFUNCTION(BlueprintPure, Category = "CrimItemContainer")
 	int32 GetConsumedCapacity() const;
@@ -82,7 +84,7 @@ public:
 	bool IsAtMaxCapacity() const;
 
 	/**
-	 * Iterates through all ItemContainers from the cached ItemManager property for items with a matching ItemDefinition.
+	 * Uses the ItemManager's running total of item stacks with a matching ItemDefinition across all ItemContainers.
 	 * CollectionLimit - Total Items stacks.
 	 * @param TestItem The Item to check.
 	 * @return The number of remaining item stacks that are allowed to be added for items across all ItemContainers.
@@ -91,8 +93,8 @@ public:
 	int32 GetRemainingCollectionCapacityForItem(const TInstancedStruct<FCrimItem>& TestItem) const;
 	
 	/**
-	 * Gets all items with matching ItemDefinitions. Then adds up the quantity for each item and compares that number
-	 * to the limit. The limit considers the remaining ItemContainer capacity and Item limits.
+	 * Compares the summed quantity of items with matching ItemDefinitions to the limit. The limit considers the
+	 * remaining ItemContainer capacity and Item limits.
 	 * @param TestItem The item to match against. 
 	 * @return The maximum amount allowed to be added to the container.
 	 */
@@ -116,7 +118,7 @@ public:
 	virtual int32 GetItemQuantityLimit(const TInstancedStruct<FCrimItem>& TestItem) const;
 
 	/**
-	 * Counts the number of Items with the same ItemDef and compares it to GetItemContainerLimit.
+	 * Compares the number of Items with the same ItemDef to GetItemContainerLimit.
 	 * @param TestItem The item to check.
 	 * @return True if no more item stacks can be created in this container.
 	 */
@@ -132,7 +134,7 @@ public:
 	bool CanSplitItemStack(const TInstancedStruct<FCrimItem>& TestItem, int32 Quantity) const;
 
 	/**
-	 * Tries to split the item stack in the existing container.
+	 * Tries to split the item stack in the existing container. Predicted on clients that CanPredictItemChanges.
 	 * @param ItemId The Item to try and split.
 	 * @param Quantity The amount to split off from the original item into to the new item.
 	 */
@@ -150,7 +152,8 @@ public:
 	bool CanStackItems(const TInstancedStruct<FCrimItem>& SourceItem, const TInstancedStruct<FCrimItem>& TargetItem, int32& OutMaxQuantity) const;
 
 	/**
-	 * Tries to stack the SourceItem into the TargetItem by the specified quantity.
+	 * Tries to stack the SourceItem into the TargetItem by the specified quantity. Predicted on clients that
+	 * CanPredictItemChanges.
 	 * @param SourceItemId The item you want to merge.
 	 * @param TargetItemId The SourceItem will attempt to merge into this item.
 	 * @param Quantity The amount from the SourceItem to stack with the TargetItem.
@@ -161,4 +164,16 @@ public:
 protected:
 
 	virtual FCrimAddItemPlan GetAddItemPlan(const TInstancedStruct<FCrimItem>& Item) const override;
+
+	/**
+	 * Splits Quantity off the item into a new item with the NewItemGuid.
+	 * @return True if the item was split.
+	 */
+	bool Internal_SplitItemStack(const FGuid& ItemId, int32 Quantity, const FGuid& NewItemGuid);
+
+	/**
+	 * Moves up to Quantity from the SourceItem into the TargetItem.
+	 * @return True if any quantity was moved.
+	 */
+	bool Internal_StackItems(const FGuid& SourceItemId, const FGuid& TargetItemId, int32 Quantity);
 };
@@ -13,7 +13,9 @@
 
 class UCrimItemContainerRule;
 class UCrimItemContainerViewModelBase;
+struct FCrimItemBatchScope;
 DECLARE_MULTICAST_DELEGATE_TwoParams(FCrimItemContainerFastItemSignature, UCrimItemContainerBase*, const FFastCrimItem&);
+DECLARE_MULTICAST_DELEGATE_TwoParams(FCrimItemContainerChangesetSignature, UCrimItemContainerBase*, const FCrimItemContainerChangeset&);
 
 /**
  * An object that holds one or more item instances. Like an inventory, treasure chest, item pickup, etc...
@@ -44,11 +46,67 @@ protected:
 	UPROPERTY(EditAnywhere, Category = "CrimItemContainer")
 	FGameplayTagContainer OwnedTags;
 
+	/**
+	 * If true, every item keeps a copy of its previous value, available from FFastCrimItem::GetPreReplicatedItem in the
+	 * item changed events. This doubles the memory of each item and copies it on every change, so only enable it on
+	 * containers whose change handlers compare against the previous value.
+	 */
+	UPROPERTY(EditDefaultsOnly, Category = "CrimItemContainer")
+	bool bKeepPreReplicatedItems = false;
+
+	/**
+	 * Item capacity up to which removing items never frees the memory of the ItemList, so containers that fill and
+	 * empty repeatedly do not reallocate. Above it, the memory is freed once less than a quarter of it is in use.
+	 */
+	UPROPERTY(EditDefaultsOnly, Category = "CrimItemContainer", meta = (ClampMin = 0))
+	int32 MinShrinkCapacity = 64;
+
+	/**
+	 * Which connections this container and its items are replicated to. Applied when the ItemManager creates the
+	 * container, and honored by both the legacy replication and Iris.
+	 */
+	UPROPERTY(EditDefaultsOnly, Category = "CrimItemContainer|Replication")
+	ECrimItemContainerReplication ReplicationPolicy = ECrimItemContainerReplication::Public;
+
+	/**
+	 * The net condition group of the container when the ReplicationPolicy is NetConditionGroup. Connections receive it
+	 * once their player controller is added with APlayerController::IncludeInNetConditionGroup.
+	 */
+	UPROPERTY(EditDefaultsOnly, Category = "CrimItemContainer|Replication", meta = (EditCondition = "ReplicationPolicy == ECrimItemContainerReplication::NetConditionGroup"))
+	FName NetConditionGroup;
+
+	/**
+	 * The most items sent per net update to a connection that does not have them yet, 0 for no limit. Limits the
+	 * bandwidth spike of a large container becoming relevant, the remaining items follow in later updates, the most
+	 * recently added or prioritized first. Changes to items a connection already has are never held back.
+	 * @note Only applies to the legacy replication. Iris replicates the ItemList with its own fast array serializer.
+	 */
+	UPROPERTY(EditDefaultsOnly, Category = "CrimItemContainer|Replication", meta = (ClampMin = 0))
+	int32 MaxNewItemsPerNetUpdate = 0;
+
+	/**
+	 * The most bytes of new items sent per net update to a connection that does not have them yet, 0 for no limit.
+	 * Works with MaxNewItemsPerNetUpdate, items are held back once either budget is used up. The size of each item is
+	 * estimated by serializing it without a package map, and the first item is always sent so large items can't stall.
+	 * @note Only applies to the legacy replication.
+	 */
+	UPROPERTY(EditDefaultsOnly, Category = "CrimItemContainer|Replication", meta = (ClampMin = 0))
+	int32 MaxNewItemBytesPerNetUpdate = 0;
+
+	/**
+	 * If true, the client owning the ItemManager applies SplitItemStack, StackItems and ConsumeItem to its own copy of
+	 * the items right away and asks the server to make the same change. The server then confirms the change or the
+	 * client rolls it back.
+	 */
+	UPROPERTY(EditDefaultsOnly, Category = "CrimItemContainer|Replication")
+	bool bAllowClientPrediction = false;
+
 public:
 	UCrimItemContainerBase();
 	virtual void PostInitProperties() override;
 	virtual bool IsSupportedForNetworking() const override {return true;}
 	virtual void GetLifetimeReplicatedProps(TArray<class FLifetimeProperty>& OutLifetimeProps) const override;
+	virtual void GetResourceSizeEx(FResourceSizeEx& CumulativeResourceSize) override;
 #if UE_WITH_IRIS
 	virtual void RegisterReplicationFragments(UE::Net::FFragmentRegistrationContext& Context, UE::Net::EFragmentRegistrationFlags RegistrationFlags) override;
 #endif
@@ -59,6 +117,8 @@ public:
 	FCrimItemContainerFastItemSignature OnItemRemovedDelegate;
 	/** Called when an item's property has changed in the container. */
 	FCrimItemContainerFastItemSignature OnItemChangedDelegate;
+	/** Called once when the last FCrimItemBatchScope on the container closes, with everything that changed in it. */
+	FCrimItemContainerChangesetSignature OnItemsChangedDelegate;
 	
 	/** Returns the Container's Guid. */
 	UFUNCTION(BlueprintPure, Category = "CrimItemContainer")
@@ -72,6 +132,37 @@ public:
 	UFUNCTION(BlueprintPure, Category = "CrimItemContainer")
 	TSoftClassPtr<UCrimItemContainerViewModelBase> GetViewModelClass() const {return ViewModelClass;}
 
+	/** Returns which connections this container is replicated to. */
+	UFUNCTION(BlueprintPure, Category = "CrimItemContainer")
+	ECrimItemContainerReplication GetReplicationPolicy() const {return ReplicationPolicy;}
+
+	/**
+	 * Returns the net condition group this container is registered in when the ReplicationPolicy is NetConditionGroup.
+	 * Override to choose the group at runtime, for example from the team of the owning actor.
+	 */
+	virtual FName GetNetConditionGroup() const {return NetConditionGroup;}
+
+	/** Returns the subobject replication condition for the ReplicationPolicy. */
+	ELifetimeCondition GetReplicationCondition() const;
+
+	/**
+	 * Sends the item ahead of all others held back by the net update budget, for example when it becomes visible in
+	 * the UI of the connections that are still waiting on it.
+	 */
+	UFUNCTION(BlueprintCallable, BlueprintAuthorityOnly, Category = "CrimItemContainer")
+	void PrioritizeItemReplication(FGuid ItemGuid);
+
+	/** Returns how many items have been held back by the net update budget, aggregated over all connections. */
+	UFUNCTION(BlueprintPure, Category = "CrimItemContainer")
+	const FCrimItemNetBacklogStats& GetNetBacklogStats() const;
+
+	/** Returns true if clients may predict changes to this container. See bAllowClientPrediction. */
+	bool IsClientPredictionAllowed() const {return bAllowClientPrediction;}
+
+	/** Returns true if changes made on this client are predicted and sent to the server. */
+	UFUNCTION(BlueprintPure, Category = "CrimItemContainer")
+	bool CanPredictItemChanges() const;
+
 	/** Returns the Container's owned gameplay tags. */
 	UFUNCTION(BlueprintPure, Category = "CrimItemContainer")
 	const FGameplayTagContainer& GetOwnedTags() const;
@@ -100,6 +191,31 @@ public:
 	UFUNCTION(BlueprintPure, Category = "CrimItemContainer", DisplayName = "GetItemByGuid")
 	TInstancedStruct<FCrimItem> K2_GetItemByGuid(FGuid ItemGuid) const;
 
+	/**
+	 * Calls Func for every item in the container. Return false from Func to stop iterating.
+	 * @note Func must not add items to the container. It may only remove them while a FCrimItemBatchScope is open.
+	 */
+	void ForEachItem(TFunctionRef<bool(FFastCrimItem&)> Func) const;
+
+	/**
+	 * Calls Func for every item in the container with the ItemDefinition. Return false from Func to stop iterating.
+	 * @note Func must not add items to the container. It may only remove them while a FCrimItemBatchScope is open.
+	 */
+	void ForEachItemByDefinition(const UCrimItemDefinition* ItemDefinition, TFunctionRef<bool(FFastCrimItem&)> Func) const;
+
+	/**
+	 * Calls Func for every item in the container that matches the TestItem. Return false from Func to stop iterating.
+	 * See FCrimItem::IsMatching
+	 * @note Func must not add items to the container. It may only remove them while a FCrimItemBatchScope is open.
+	 */
+	void ForEachMatchingItem(const TInstancedStruct<FCrimItem>& TestItem, TFunctionRef<bool(FFastCrimItem&)> Func) const;
+
+	/**
+	 * Calls Func for every item in the container that matches the TestItem and has less than MaxQuantity. Return false
+	 * from Func to stop iterating. Same rules as ForEachMatchingItem.
+	 */
+	void ForEachMatchingItemBelowQuantity(const TInstancedStruct<FCrimItem>& TestItem, int32 MaxQuantity, TFunctionRef<bool(FFastCrimItem&)> Func) const;
+
 	/**
 	 * @return The first item found with the matching ItemDefinition.
 	 */
@@ -175,6 +291,23 @@ public:
 	UFUNCTION(BlueprintCallable, BlueprintAuthorityOnly, Category = "CrimItemContainer")
 	FCrimAddItemResult TryAddItem(UPARAM(ref) const TInstancedStruct<FCrimItem>& Item);
 
+	/**
+	 * Tries to add multiple items to this container. All Items are planned together against the container as it is,
+	 * each on top of the ones before it, and the plans are then executed in one batch. Existing items that are modified
+	 * by more than one of the Items are only marked dirty and broadcast once, after all Items have been added.
+	 * @param Items The items to add.
+	 * @return The result for each item, in the same order as Items.
+	 */
+	TArray<FCrimAddItemResult> TryAddItems(TArrayView<const TInstancedStruct<FCrimItem>> Items);
+
+	/**
+	 * Tries to add multiple items to this container.
+	 * @param Items The items to add.
+	 * @return The result for each item, in the same order as Items.
+	 */
+	UFUNCTION(BlueprintCallable, BlueprintAuthorityOnly, Category = "CrimItemContainer", DisplayName = "TryAddItems")
+	TArray<FCrimAddItemResult> K2_TryAddItems(const TArray<TInstancedStruct<FCrimItem>>& Items);
+
 	/**
 	 * Checks to see if the item can be added to the ItemContainer.
 	 * @param Item The item to check.
@@ -183,15 +316,41 @@ public:
 	 */
 	virtual bool CanAddItem(const TInstancedStruct<FCrimItem>& Item, FGameplayTag& OutError) const;
 
+	/**
+	 * Builds a plan for adding the item to this container without modifying it. The plan can be used to preview the add
+	 * and then be passed to ExecutePlan, as long as the container has not been modified in between.
+	 * @param Item The item to plan for.
+	 * @return The plan. If the item can't be added, the plan has no entries and the Error is set.
+	 */
+	FCrimAddItemPlan PlanAddItem(const TInstancedStruct<FCrimItem>& Item) const;
+
+	/**
+	 * Executes a plan built by PlanAddItem without recomputing it.
+	 * @param Item The item the plan was built for.
+	 * @param AddItemPlan The plan to execute. If the container was modified since the plan was built, nothing is added
+	 * and the result's Error is ItemPlan.Error.StalePlan.
+	 * @return The actual amount of the item that was added and any errors if the item could not be added in full.
+	 */
+	FCrimAddItemResult ExecutePlan(const TInstancedStruct<FCrimItem>& Item, const FCrimAddItemPlan& AddItemPlan);
+
+	/**
+	 * Returns true if the AddItemPlan was built by this container and neither the container nor the other ItemContainers
+	 * of its ItemManager have been modified since.
+	 */
+	bool IsPlanCurrent(const FCrimAddItemPlan& AddItemPlan) const;
+
+	/** Returns the modification version of this container's items. It changes whenever an item is added, removed or modified. */
+	uint32 GetModificationVersion() const;
+
 	/**
 	 * Consumes the specified quantity of the item. The item's quantity can't go below 0. If it is 0, the item is 
-	 * removed from the ItemContainer.
+	 * removed from the ItemContainer. Predicted on clients that CanPredictItemChanges.
 	 * @param ItemGuid The item to consume quantity from.
 	 * @param Quantity The amount to subtract from the item.
 	 * @param bRemoveItem If false, the item will not be removed from the ItemContainer when the quantity reaches 0.
 	 * @return The amount actually consumed.
 	 */
-	UFUNCTION(BlueprintCallable, BlueprintAuthorityOnly, Category = "CrimItemContainer")
+	UFUNCTION(BlueprintCallable, Category = "CrimItemContainer")
 	int32 ConsumeItem(const FGuid ItemGuid, const int32 Quantity, bool bRemoveItem = true);
 
 	/**
@@ -213,6 +372,20 @@ public:
 	UFUNCTION(BlueprintCallable, BlueprintAuthorityOnly, Category = "CrimItemContainer")
 	TInstancedStruct<FCrimItem> RemoveItem(const FGuid ItemGuid);
 
+	/**
+	 * Moves an item from this ItemContainer to the TargetContainer. Both sides are validated before anything is changed.
+	 * Only the quantity the TargetContainer accepts is taken from the item. When the whole stack is added to the
+	 * TargetContainer as a new item, it keeps its ItemGuid and the ItemManager broadcasts it as a single OnItemMoved.
+	 * The item is removed and added the same way RemoveItem and TryAddItem do, so inside a FCrimItemBatchScope the
+	 * removal is deferred until the batch ends.
+	 * @param ItemGuid The item in this ItemContainer to move.
+	 * @param TargetContainer The ItemContainer to move the item to.
+	 * @param Quantity The amount to move. If it is 0 or more than the item's quantity, the whole stack is moved.
+	 * @return The result of adding the item to the TargetContainer.
+	 */
+	UFUNCTION(BlueprintCallable, BlueprintAuthorityOnly, Category = "CrimItemContainer")
+	FCrimAddItemResult MoveItem(const FGuid ItemGuid, UCrimItemContainerBase* TargetContainer, int32 Quantity = 0);
+
 	/**
 	 * Finds all items by ItemDefinition to remove from the ItemContainer.
 	 * @param ItemDefinition Items with this definition will be removed.
@@ -229,8 +402,13 @@ public:
 
 	/**
 	 * You must manually call this when an Item stored in this ItemContainer has been modified.
+	 * While a FCrimItemBatchScope is open, replicating and broadcasting the change is deferred until it closes.
+	 * @param Sections The parts of the item that were modified. Clients that already have the item are only sent these.
 	 */
-	void MarkItemDirty(FFastCrimItem& FastItem);
+	void MarkItemDirty(FFastCrimItem& FastItem, ECrimItemNetSection Sections = ECrimItemNetSection::All);
+
+	/** Returns true if a FCrimItemBatchScope is open on this container. */
+	bool IsBatching() const {return BatchDepth > 0;}
 
 	UFUNCTION(BlueprintPure, Category = "CrimItemContainer")
 	bool HasAuthority() const {return bOwnerIsNetAuthority;}
@@ -250,6 +428,32 @@ protected:
 	 */
 	virtual FCrimAddItemPlan GetAddItemPlan(const TInstancedStruct<FCrimItem>& Item) const;
 
+	/** What the Items planned so far by PlanAddItems will add to the container. */
+	struct FPlannedAdditions
+	{
+		/** The quantity planned for each existing item. */
+		TMap<const FFastCrimItem*, int32> QuantityByItem;
+		/** The quantity planned by ItemDefinition, for existing and new items. */
+		TMap<FCrimItemDefinitionHandle, int32> QuantityByDefinition;
+		/** The number of new items planned by ItemDefinition. */
+		TMap<FCrimItemDefinitionHandle, int32> NewItemsByDefinition;
+		int32 NumNewItems = 0;
+
+		void Add(const TInstancedStruct<FCrimItem>& Item, const FCrimAddItemPlan& AddItemPlan);
+	};
+
+	/**
+	 * Returns the additions planned for the earlier Items while PlanAddItems builds the plan of a later one, otherwise
+	 * null. GetAddItemPlan and the capacity checks it uses must treat them as already added.
+	 */
+	const FPlannedAdditions* GetPlannedAdditions() const {return PlannedAdditions;}
+
+	/**
+	 * Builds the plans for adding all Items, each on top of the ones before it, without modifying the container.
+	 * The plans after the first are only valid if the earlier ones are executed, see TryAddItems.
+	 */
+	TArray<FCrimAddItemPlan> PlanAddItems(TArrayView<const TInstancedStruct<FCrimItem>> Items) const;
+
 	/**
 	 * Called in ExecuteAddItemPlan just before the item is added to the ItemContainer ItemList. Gives you a chance to
 	 * modify the item before it's added to the container. It is a duplicate of the original item.
@@ -288,10 +492,38 @@ protected:
 	 * @note Assumes all data is valid before adding to the List.
 	 */
 	void Internal_AddItem(TInstancedStruct<FCrimItem>& Item);
+	void Internal_AddItem(TInstancedStruct<FCrimItem>&& Item);
 
 	/** Removes the item from the container by Guid */
 	void Internal_RemoveItem(const FGuid& ItemGuid);
 
+	/** Consumes Quantity from the item. See ConsumeItem. */
+	int32 Internal_ConsumeItem(const FGuid& ItemGuid, int32 Quantity, bool bRemoveItem);
+
+	/**
+	 * Same as DuplicateItem, but gives the copy the NewItemGuid. Used when a client predicted the new item, so the
+	 * server's copy replaces the predicted one.
+	 */
+	static TInstancedStruct<FCrimItem> DuplicateItemWithGuid(const TInstancedStruct<FCrimItem>& Item, const FGuid& NewItemGuid);
+
+	/**
+	 * Starts recording a prediction. Until EndPrediction is called, Internal_AddItem, Internal_RemoveItem and
+	 * MarkItemDirty change the client's copy of the items and broadcast the changes.
+	 */
+	void BeginPrediction();
+
+	/**
+	 * Stops recording the prediction.
+	 * @return The key to send to the server with the change, or INDEX_NONE if nothing was predicted.
+	 */
+	int32 EndPrediction();
+
+	/** Returns true between BeginPrediction and EndPrediction. */
+	bool IsPredicting() const {return bIsPredicting;}
+
+	/** Saves the item so it can be restored if the prediction is rolled back. Call before modifying an existing item. */
+	void RecordPredictedChange(const FFastCrimItem& FastItem);
+
 	/**
 	 * Executes the AddItemPlan and returns a copy of the Items added or modified in the Container.
 	 * The plan will ensure no duplicate ItemGuids are added to the Container.
@@ -307,6 +539,59 @@ private:
 	TObjectPtr<UCrimItemManagerComponent> ItemManagerComponent;
 	UPROPERTY()
 	bool bOwnerIsNetAuthority = false;
+
+	/** The number of open FCrimItemBatchScopes on this container. */
+	int32 BatchDepth = 0;
+	/**
+	 * Items removed while batching. They stay in the ItemList until the batch ends so pointers to items remain valid,
+	 * but are hidden from the lookup functions.
+	 */
+	TSet<FGuid> PendingRemovedItems;
+	/** Items modified while batching. */
+	TSet<FGuid> PendingDirtyItems;
+	/** Items added to the ItemList while batching. */
+	TSet<FGuid> PendingAddedItems;
+	/** Items removed straight from the ItemList while batching, for example by ItemList.Reset. */
+	TArray<FGuid> RemovedWhileBatchingItems;
+
+	/** Set while PlanAddItems runs. See GetPlannedAdditions. */
+	mutable const FPlannedAdditions* PlannedAdditions = nullptr;
+
+	/** A change predicted by the client that the server has not confirmed yet. */
+	struct FPredictedChange
+	{
+		int32 PredictionKey = INDEX_NONE;
+		/** The value of the existing items from before the prediction changed them. */
+		TArray<TInstancedStruct<FCrimItem>> ChangedItems;
+		/** Items added by the prediction. They are not replicated until the server's copy replaces them. */
+		TArray<FGuid> AddedItems;
+		/** Items removed by the prediction. */
+		TArray<FGuid> RemovedItems;
+	};
+
+	/** The predictions waiting on the server, oldest first. */
+	TArray<FPredictedChange> PendingPredictions;
+	/**
+	 * Items removed by a prediction. They stay in the ItemList until the server removes them, but are hidden from the
+	 * lookup functions.
+	 */
+	TSet<FGuid> PredictedRemovedItems;
+	int32 LastPredictionKey = 0;
+	bool bIsPredicting = false;
+
+	/** Confirms or rolls back the prediction. Called by the ItemManager once the server has made the change. */
+	void OnPredictionResult(int32 PredictionKey, bool bAccepted);
+	/** Restores the items changed by the Prediction. */
+	void RollbackPrediction(const FPredictedChange& Prediction);
+
+	void BeginBatch();
+	/**
+	 * Removes the PendingRemovedItems, marks the PendingDirtyItems dirty and broadcasts the changeset. The pending items
+	 * are kept in sets while batching, so looking them up does not grow with the size of the batch.
+	 */
+	void EndBatch();
+	bool IsPendingRemoval(const FFastCrimItem& FastItem) const;
+	friend FCrimItemBatchScope;
 	
 	void BindToItemListDelegates();
 
@@ -314,3 +599,21 @@ private:
 	void Internal_OnItemRemoved(const FFastCrimItem& FastItem);
 	void Internal_OnItemChanged(const FFastCrimItem& FastItem);
 };
+
+/**
+ * Defers item removals, dirty marking and change broadcasts on ItemContainers until the scope is closed. Each
+ * ItemContainer then removes its items, marks its modified items dirty once and broadcasts a single OnItemsChangedDelegate.
+ * Scopes can be nested, only the outermost one flushes. Has no effect on clients.
+ */
+struct CRIMITEMSYSTEM_API FCrimItemBatchScope
+{
+	explicit FCrimItemBatchScope(UCrimItemContainerBase* ItemContainer);
+	/** Opens the scope on all ItemContainers owned by the ItemManager. */
+	explicit FCrimItemBatchScope(const UCrimItemManagerComponent* ItemManager);
+	~FCrimItemBatchScope();
+
+	UE_NONCOPYABLE(FCrimItemBatchScope);
+
+private:
+	TArray<TWeakObjectPtr<UCrimItemContainerBase>, TInlineAllocator<4>> ItemContainers;
+};